@@ -37,9 +37,30 @@
 #define FS_DNAME_DOT "."
 #define FS_DNAME_DOTDOT ".."
 
+/*
+ * Flags of mount
+ * bits 4-15 hold budget of memory of dentries and inodes in MB, 0 for unlimited
+ * bits 16-31 hold number of blocks in cache, 0 for default
+ */
+#define FS_MNT_NOCACHE     0x1
+#define FS_MNT_DIRECT      0x2
+#define FS_MNT_MEM_SHIFT   4
+#define FS_MNT_MEM_MASK    0xFFF
+#define FS_MNT_MEM(n)      ((int32_t)(((uint32_t)(n) & FS_MNT_MEM_MASK) << FS_MNT_MEM_SHIFT))
+#define FS_MNT_CACHE_SHIFT 16
+#define FS_MNT_CACHE_MASK  0xFFFF
+#define FS_MNT_CACHE(n)    ((int32_t)(((uint32_t)(n) & FS_MNT_CACHE_MASK) << FS_MNT_CACHE_SHIFT))
+
+#define FS_IOSTATS_LAT_NUM 16
+
 /*
  * Type Definition
  */
+/*
+ * Session of image mounted, opaque to caller
+ */
+struct fs_session;
+
 enum libfs_ftype {
   FT_UNKNOWN  = 0,
   FT_REG_FILE = 1,
@@ -127,16 +148,75 @@ struct fs_dirent {
   uint8_t          padding1[4];
 };
 
+/*
+ * Dirent with stats of file, returned by readdirplus
+ */
+struct fs_direntplus {
+  struct fs_dirent dirent;
+  struct fs_kstat  stat;
+};
+
+/*
+ * Counters of IO of mount,
+ * lat[i] counts reads taking less than 2^i us, and the last one the rest,
+ * mem is bytes of dentries and inodes resident, with budget of them,
+ * and evicts counts dentries and inodes evicted to keep within budget
+ */
+struct fs_iostats {
+  uint64_t reads;
+  uint64_t seeks;
+  uint64_t bytes;
+  uint64_t cache_hits;
+  uint64_t cache_misses;
+  uint64_t lat[FS_IOSTATS_LAT_NUM];
+  uint64_t mem;
+  uint64_t mem_budget;
+  uint64_t evicts;
+};
+
 struct fs_opt_t {
-  int32_t (*mount) (const char *devname, const char *dirname, const char *type, int32_t flags, struct fs_dirent *dirent);
-  int32_t (*umount) (const char *dirname, int32_t flags);
-  int32_t (*statfs) (const char *pathname, struct fs_kstatfs *buf);
-  int32_t (*statrawfs) (const char *pathname, const char **buf);
-  int32_t (*stat) (uint64_t ino, struct fs_kstat *buf);
-  int32_t (*statraw) (uint64_t ino, const char **buf);
-  int32_t (*querydent) (uint64_t ino, struct fs_dirent *dirent);
-  int32_t (*getdents) (uint64_t ino, struct fs_dirent *dirents, uint32_t count);
-  int32_t (*readfile) (uint64_t ino, int64_t offset, char *buf, int64_t count, int64_t *num);
+  /*
+   * devname may select partition of disk image by '#', e.g.,
+   * image.bin#p12, image.bin#system or image.bin#0x100000:0x400000
+   *
+   * session is returned for image mounted, and taken by all other operations,
+   * so that images may be mounted at the same time
+   *
+   * Operations but mount & umount may be called by threads at the same time
+   * on one session, and raw stats returned by statrawfs & statraw are valid
+   * until next call of them on the same thread
+   *
+   * readdirplus returns up to count dirents with stats of ino in num,
+   * from cursor of 0 at first, and updates cursor to resume with,
+   * and num less than count means the end of directory
+   *
+   * readdir returns dirents the same way without stats, and both of them
+   * parse directory only as far as the page returned, unlike getdents
+   * and querydent which parse the whole of it
+   *
+   * lookup returns dirent of name in directory of ino, and resolve returns
+   * dirent of pathname from root of mount, with names separated by '/',
+   * and '.' or '..' taken as in directory, and symbolic links not followed
+   * Both of them parse directory only as far as name is found
+   *
+   * With budget of memory set by FS_MNT_MEM, dentries and inodes parsed
+   * are evicted least recently used first to keep within it, and parsed
+   * again on demand, so that ino returned before stays valid
+   */
+  int32_t (*mount) (const char *devname, const char *dirname, const char *type, int32_t flags, struct fs_dirent *dirent, struct fs_session **session);
+  int32_t (*umount) (struct fs_session *session, const char *dirname, int32_t flags);
+  int32_t (*statfs) (struct fs_session *session, const char *pathname, struct fs_kstatfs *buf);
+  int32_t (*statrawfs) (struct fs_session *session, const char *pathname, const char **buf);
+  int32_t (*stat) (struct fs_session *session, uint64_t ino, struct fs_kstat *buf);
+  int32_t (*statraw) (struct fs_session *session, uint64_t ino, const char **buf);
+  int32_t (*querydent) (struct fs_session *session, uint64_t ino, struct fs_dirent *dirent);
+  int32_t (*getdents) (struct fs_session *session, uint64_t ino, struct fs_dirent *dirents, uint32_t count);
+  int32_t (*readfile) (struct fs_session *session, uint64_t ino, int64_t offset, char *buf, int64_t count, int64_t *num);
+  int32_t (*iostats) (struct fs_session *session, const char *pathname, struct fs_iostats *buf);
+  int32_t (*readdirplus) (struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_direntplus *entries, uint32_t count, uint32_t *num);
+  int32_t (*readdir) (struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_dirent *dirents, uint32_t count, uint32_t *num);
+  int32_t (*lookup) (struct fs_session *session, uint64_t ino, const char *name, struct fs_dirent *dirent);
+  int32_t (*resolve) (struct fs_session *session, const char *pathname, struct fs_dirent *dirent);
 };
 
 /*
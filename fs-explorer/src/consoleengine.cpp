@@ -58,56 +58,24 @@ QStringList ConsoleEngine::run(const QString &cmd, const QStringList &args)
 
 bool ConsoleEngine::traversePath(unsigned long long curIno, QStringList path, unsigned long long &foundIno)
 {
-  bool ret;
-
-  if (path.size() == 0) {
-    return true;
-  }
-
-  if (path.join(tr("")).size() == 0) {
-    return true;
-  }
-
-  unsigned int num = fsEngine->getFileChildsNum(curIno);
-  if (num == 0) {
-    return true;
-  }
-
-  struct fs_dirent *childs = new fs_dirent[num];
-  if (!childs) {
-    return false;
-  }
-  memset((void *)childs, 0, sizeof(struct fs_dirent) * num);
-
-  ret = fsEngine->getFileChildsList(curIno, childs, num);
-  if (!ret) {
-    goto traversePathExit;
-  }
+  struct fs_dirent dent;
 
-  ret = false;
+  foundIno = curIno;
 
-  for (unsigned int i = 0; i < num; ++i) {
-    if (path[0].compare(tr(childs[i].d_name)) == 0) {
-      foundIno = static_cast<unsigned long long> (childs[i].d_ino);
-      ret = true;
-      break;
+  for (int i = 0; i < path.size(); ++i) {
+    if (path[i].size() == 0) {
+      continue;
     }
-  }
 
-  if (ret) {
-    curIno = foundIno;
-    path.removeFirst();
-    ret = traversePath(curIno, path, foundIno);
-  }
-
-traversePathExit:
+    if (!fsEngine->getFileChildsLookup(curIno, path[i], dent)) {
+      return false;
+    }
 
-  if (childs) {
-    delete[] childs;
-    childs = NULL;
+    curIno = static_cast<unsigned long long> (dent.d_ino);
+    foundIno = curIno;
   }
 
-  return ret;
+  return true;
 }
 
 QString ConsoleEngine::formatPath(const QString &path)
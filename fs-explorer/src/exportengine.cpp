@@ -21,7 +21,7 @@
 
 #include "exportengine.h"
 
-const int ExportEngine::size = 1024;
+const int ExportEngine::size = 0x100000;
 
 ExportEngine::ExportEngine(const QList<unsigned long long> &list, const QString &path, FsEngine *engine)
 {
@@ -34,6 +34,7 @@ FsEngine::FsEngine(QWidget *parent)
 
   fileLib = NULL;
   fileOpt = NULL;
+  fileSession = NULL;
   fileName = NULL;
   fileMount = NULL;
   fileType = NULL;
@@ -47,10 +48,11 @@ FsEngine::~FsEngine()
   closeFile();
 }
 
-bool FsEngine::openFile(const QString &name)
+bool FsEngine::openFile(const QString &name, bool directIo)
 {
+  QWriteLocker locker(&lock);
   const char *dev = NULL, *dir = NULL, *type = NULL;
-  int32_t i, len;
+  int32_t i, len, flags;
   int32_t ret;
 
   if (name.isEmpty()) {
@@ -72,6 +74,7 @@ bool FsEngine::openFile(const QString &name)
   dev = (const char *)name.toLocal8Bit().data();
   dir = (const char *)"/";
   len = sizeof(fileTypeList) / sizeof(const char*);
+  flags = directIo ? FS_MNT_DIRECT : 0;
 
   fileRoot = new fs_dirent;
   if (!fileRoot) {
@@ -81,7 +84,7 @@ bool FsEngine::openFile(const QString &name)
 
   for (i = 0; i < len; ++i) {
     type = fileTypeList[i];
-    ret = fileOpt->mount(dev, dir, type, 0, fileRoot);
+    ret = fileOpt->mount(dev, dir, type, flags, fileRoot, &fileSession);
     if (ret == 0) {
       break;
     }
@@ -102,12 +105,21 @@ bool FsEngine::openFile(const QString &name)
 
 openFileFail:
 
-  closeFile();
+  releaseFile();
 
   return false;
 }
 
 bool FsEngine::closeFile()
+{
+  QWriteLocker locker(&lock);
+
+  releaseFile();
+
+  return true;
+}
+
+void FsEngine::releaseFile()
 {
   if (fileType) {
     delete fileType;
@@ -119,8 +131,9 @@ bool FsEngine::closeFile()
     fileName = NULL;
   }
 
-  if (fileOpt && fileOpt->umount && fileMount) {
-    (void)fileOpt->umount((const char *)fileMount->toLatin1().data(), 0);
+  if (fileOpt && fileOpt->umount && fileSession && fileMount) {
+    (void)fileOpt->umount(fileSession, (const char *)fileMount->toLatin1().data(), 0);
+    fileSession = NULL;
   }
 
   if (fileMount) {
@@ -134,8 +147,6 @@ bool FsEngine::closeFile()
   }
 
   unloadLibrary();
-
-  return true;
 }
 
 bool FsEngine::isReadOnly() const
@@ -145,6 +156,8 @@ bool FsEngine::isReadOnly() const
 
 QString FsEngine::getFileType() const
 {
+  QReadLocker locker(&lock);
+
   if (!fileType) {
     return QString("N/A");
   }
@@ -154,7 +167,7 @@ QString FsEngine::getFileType() const
 
 struct fs_kstatfs FsEngine::getFileStat()
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
   struct fs_kstatfs buf;
 
   memset((void *)&buf, 0, sizeof(struct fs_kstatfs));
@@ -163,7 +176,7 @@ struct fs_kstatfs FsEngine::getFileStat()
     return buf;
   }
 
-  int32_t ret = fileOpt->statfs((const char *)fileName->constData(), &buf);
+  int32_t ret = fileOpt->statfs(fileSession, (const char *)fileName->constData(), &buf);
   if (ret != 0) {
     return buf;
   }
@@ -173,7 +186,7 @@ struct fs_kstatfs FsEngine::getFileStat()
 
 QString FsEngine::getFileStatDetail()
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
   QString str;
   const char *buf = NULL;
 
@@ -183,7 +196,7 @@ QString FsEngine::getFileStatDetail()
     return str;
   }
 
-  int32_t ret = fileOpt->statrawfs((const char *)fileName->constData(), &buf);
+  int32_t ret = fileOpt->statrawfs(fileSession, (const char *)fileName->constData(), &buf);
   if (ret != 0 || !buf) {
     return str;
   }
@@ -192,6 +205,50 @@ QString FsEngine::getFileStatDetail()
   return str;
 }
 
+QString FsEngine::getFileIoStatDetail()
+{
+  QReadLocker locker(&lock);
+  QString str;
+  struct fs_iostats stats;
+
+  str.clear();
+
+  if (!fileOpt || !fileOpt->iostats || !fileMount) {
+    return str;
+  }
+
+  memset((void *)&stats, 0, sizeof(struct fs_iostats));
+
+  int32_t ret = fileOpt->iostats(fileSession, (const char *)fileMount->toLatin1().data(), &stats);
+  if (ret != 0) {
+    return str;
+  }
+
+  str.append(QString(tr("reads: %1\n")).arg(stats.reads));
+  str.append(QString(tr("seeks: %1\n")).arg(stats.seeks));
+  str.append(QString(tr("bytes: %1\n")).arg(stats.bytes));
+  str.append(QString(tr("cache hits: %1\n")).arg(stats.cache_hits));
+  str.append(QString(tr("cache misses: %1\n")).arg(stats.cache_misses));
+
+  for (int i = 0; i < FS_IOSTATS_LAT_NUM; ++i) {
+    if (stats.lat[i] == 0) {
+      continue;
+    }
+
+    if (i == FS_IOSTATS_LAT_NUM - 1) {
+      str.append(QString(tr("latency >= %1us: %2\n")).arg(1ULL << (i - 1)).arg(stats.lat[i]));
+    } else {
+      str.append(QString(tr("latency < %1us: %2\n")).arg(1ULL << i).arg(stats.lat[i]));
+    }
+  }
+
+  str.append(QString(tr("mem: %1\n")).arg(stats.mem));
+  str.append(QString(tr("mem budget: %1\n")).arg(stats.mem_budget));
+  str.append(QString(tr("evicts: %1\n")).arg(stats.evicts));
+
+  return str;
+}
+
 struct fs_dirent FsEngine::getFileRoot() const
 {
   struct fs_dirent dent;
@@ -206,7 +263,7 @@ struct fs_dirent FsEngine::getFileRoot() const
 
 unsigned int FsEngine::getFileChildsNum(unsigned long long ino)
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
   struct fs_dirent parent;
 
   if (!fileOpt || !fileOpt->querydent) {
@@ -215,7 +272,7 @@ unsigned int FsEngine::getFileChildsNum(unsigned long long ino)
 
   memset((void *)&parent, 0, sizeof(struct fs_dirent));
 
-  int32_t ret = fileOpt->querydent(ino, &parent);
+  int32_t ret = fileOpt->querydent(fileSession, ino, &parent);
   if (ret != 0) {
     return 0;
   }
@@ -225,13 +282,13 @@ unsigned int FsEngine::getFileChildsNum(unsigned long long ino)
 
 bool FsEngine::getFileChildsList(unsigned long long ino, struct fs_dirent *childs, unsigned int num)
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
 
   if (!fileOpt || !fileOpt->getdents || !childs || num == 0) {
     return false;
   }
 
-  int32_t ret = fileOpt->getdents(ino, childs, num);
+  int32_t ret = fileOpt->getdents(fileSession, ino, childs, num);
   if (ret != 0) {
     return false;
   }
@@ -239,9 +296,31 @@ bool FsEngine::getFileChildsList(unsigned long long ino, struct fs_dirent *child
   return true;
 }
 
+bool FsEngine::getFileChildsListPlus(unsigned long long ino, unsigned long long *cursor, struct fs_direntplus *childs, unsigned int num, unsigned int *count)
+{
+  QReadLocker locker(&lock);
+  uint64_t pos;
+  uint32_t len = 0;
+
+  if (!fileOpt || !fileOpt->readdirplus || !cursor || !childs || num == 0 || !count) {
+    return false;
+  }
+
+  pos = *cursor;
+  int32_t ret = fileOpt->readdirplus(fileSession, ino, &pos, childs, num, &len);
+  if (ret != 0) {
+    return false;
+  }
+
+  *cursor = pos;
+  *count = len;
+
+  return true;
+}
+
 struct fs_dirent FsEngine::getFileChildsDent(unsigned long long ino)
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
   struct fs_dirent ret;
 
   memset((void *)&ret, 0, sizeof(struct fs_dirent));
@@ -250,14 +329,42 @@ struct fs_dirent FsEngine::getFileChildsDent(unsigned long long ino)
     return ret;
   }
 
-  (void)fileOpt->querydent(ino, &ret);
+  (void)fileOpt->querydent(fileSession, ino, &ret);
 
   return ret;
 }
 
+bool FsEngine::getFileChildsLookup(unsigned long long ino, const QString &name, struct fs_dirent &dent)
+{
+  QReadLocker locker(&lock);
+
+  /*
+   * Encode name by the codec names are decoded by with tr()
+   */
+#if QT_VERSION >= 0x050000
+  QByteArray buf = name.toUtf8();
+#else
+  QTextCodec *codec = QTextCodec::codecForTr();
+  QByteArray buf = codec ? codec->fromUnicode(name) : name.toLatin1();
+#endif
+
+  if (!fileOpt || !fileOpt->lookup) {
+    return false;
+  }
+
+  memset((void *)&dent, 0, sizeof(struct fs_dirent));
+
+  int32_t ret = fileOpt->lookup(fileSession, ino, (const char *)buf.constData(), &dent);
+  if (ret != 0) {
+    return false;
+  }
+
+  return true;
+}
+
 struct fs_kstat FsEngine::getFileChildsStat(unsigned long long ino)
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
   struct fs_kstat ret;
 
   memset((void *)&ret, 0, sizeof(struct fs_kstat));
@@ -266,14 +373,14 @@ struct fs_kstat FsEngine::getFileChildsStat(unsigned long long ino)
     return ret;
   }
 
-  (void)fileOpt->stat(ino, &ret);
+  (void)fileOpt->stat(fileSession, ino, &ret);
 
   return ret;
 }
 
 QString FsEngine::getFileChildsStatDetail(unsigned long long ino)
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
   QString str;
   const char *buf = NULL;
 
@@ -283,7 +390,7 @@ QString FsEngine::getFileChildsStatDetail(unsigned long long ino)
     return str;
   }
 
-  int32_t ret = fileOpt->statraw(ino, &buf);
+  int32_t ret = fileOpt->statraw(fileSession, ino, &buf);
   if (ret != 0 || !buf) {
     return str;
   }
@@ -294,7 +401,7 @@ QString FsEngine::getFileChildsStatDetail(unsigned long long ino)
 
 bool FsEngine::readFile(unsigned long long ino, long offset, char *buf, long count, long *num)
 {
-  QMutexLocker locker(&mutex);
+  QReadLocker locker(&lock);
 
   if (!buf || count <= 0 || !num) {
     return false;
@@ -304,7 +411,7 @@ bool FsEngine::readFile(unsigned long long ino, long offset, char *buf, long cou
     return false;
   }
 
-  int32_t ret = fileOpt->readfile(ino, offset, buf, count, reinterpret_cast<int64_t *> (num));
+  int32_t ret = fileOpt->readfile(fileSession, ino, offset, buf, count, reinterpret_cast<int64_t *> (num));
   if (ret != 0) {
     return false;
   }
@@ -26,7 +26,10 @@
 
 #include <QObject>
 #include <QLibrary>
-#include <QMutexLocker>
+#include <QReadWriteLock>
+#if QT_VERSION < 0x050000
+#include <QTextCodec>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,7 +45,7 @@ public:
   FsEngine(QWidget *parent = 0);
   ~FsEngine();
 
-  bool openFile(const QString &name);
+  bool openFile(const QString &name, bool directIo = false);
   bool closeFile();
 
   bool isReadOnly() const;
@@ -50,17 +53,21 @@ public:
   QString getFileType() const;
   struct fs_kstatfs getFileStat();
   QString getFileStatDetail();
+  QString getFileIoStatDetail();
   struct fs_dirent getFileRoot() const;
 
   unsigned int getFileChildsNum(unsigned long long ino);
   bool getFileChildsList(unsigned long long ino, struct fs_dirent *childs, unsigned int num);
+  bool getFileChildsListPlus(unsigned long long ino, unsigned long long *cursor, struct fs_direntplus *childs, unsigned int num, unsigned int *count);
   struct fs_dirent getFileChildsDent(unsigned long long ino);
+  bool getFileChildsLookup(unsigned long long ino, const QString &name, struct fs_dirent &dent);
   struct fs_kstat getFileChildsStat(unsigned long long ino);
   QString getFileChildsStatDetail(unsigned long long ino);
 
   bool readFile(unsigned long long ino, long offset, char *buf, long count, long *num);
 
 private:
+  void releaseFile();
   bool loadLibrary();
   void unloadLibrary();
 
@@ -68,12 +75,13 @@ private:
 
   QLibrary *fileLib;
   fs_opt_t *fileOpt;
+  struct fs_session *fileSession;
   QString *fileName;
   QString *fileMount;
   QString *fileType;
   struct fs_dirent *fileRoot;
 
-  QMutex mutex;
+  mutable QReadWriteLock lock;
   bool readOnly;
 };
 #endif
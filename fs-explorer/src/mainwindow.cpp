@@ -31,6 +31,8 @@ const QString MainWindow::label = QObject::tr("<p align=\"center\" style=\" marg
 const QString MainWindow::label = QObject::tr("<p align=\"center\"> <img src= :/images/label.png </img> </p>");
 #endif
 
+const unsigned int MainWindow::listPage = 256;
+
 MainWindow::MainWindow()
 {
   showWindowTitle();
@@ -275,6 +277,12 @@ void MainWindow::prop()
 void MainWindow::stats()
 {
   QString stat = fsEngine->getFileStatDetail();
+  QString iostat = fsEngine->getFileIoStatDetail();
+
+  if (!iostat.isEmpty()) {
+    stat.append(tr("\nio stats\n"));
+    stat.append(iostat);
+  }
 
   statsWindow = new StatsWindow(tr("Fs Stats"), stat, this);
   statsWindow->show();
@@ -534,14 +542,12 @@ void MainWindow::loadFile(const QString &orig, const QString &preproced)
     struct fs_dirent treeRoot = fsEngine->getFileRoot();
 
     treeFileDentList.clear();
-    createFileDentList(treeRoot.d_ino, treeFileDentList);
+    treeFileStatList.clear();
+    createFileList(treeRoot.d_ino, treeFileDentList, treeFileStatList);
 
     listFileDentList.clear();
     listFileDentList = treeFileDentList;
 
-    treeFileStatList.clear();
-    createFileStatList(treeFileDentList, treeFileStatList);
-
     listFileStatList.clear();
     listFileStatList = treeFileStatList;
 
@@ -1399,14 +1405,24 @@ QStringList MainWindow::parseAddress(const QString &name)
 bool MainWindow::findTreeAddress(const QString &name, QModelIndex &index)
 {
   QModelIndex childIndex;
-  QString childName;
+  unsigned long long ino, childIno;
+  struct fs_dirent dent;
   bool found = false;
 
+  /*
+   * Look up name in filesystem, and match child in tree by ino,
+   * instead of comparing names of all childs
+   */
+  ino = treeModel->data(index, TREE_INO, Qt::DisplayRole).toULongLong();
+  if (!fsEngine->getFileChildsLookup(ino, name, dent) || dent.d_type != FT_DIR) {
+    return false;
+  }
+
   for (int i = 0; i < treeModel->rowCount(index); ++i) {
     childIndex = treeModel->index(i, TREE_NAME, index);
-    childName = treeModel->data(childIndex, TREE_NAME, Qt::DisplayRole).toString();
+    childIno = treeModel->data(childIndex, TREE_INO, Qt::DisplayRole).toULongLong();
 
-    if (!QString::compare(childName, name)) {
+    if (childIno == static_cast<unsigned long long> (dent.d_ino)) {
       index = childIndex;
       found = true;
       break;
@@ -1497,29 +1513,32 @@ void MainWindow::showFileStat(unsigned long long ino) const
   setOutput(text);
 }
 
-void MainWindow::createFileDentList(unsigned long long ino, QList<struct fs_dirent> &list)
+void MainWindow::createFileList(unsigned long long ino, QList<struct fs_dirent> &dentList, QList<struct fs_kstat> &statList)
 {
-  unsigned int num = fsEngine->getFileChildsNum(ino);
-  if (num == 0) {
-    return;
-  }
+  unsigned long long cursor = 0;
+  unsigned int num = 0;
 
-  struct fs_dirent *childs = new fs_dirent[num];
+  struct fs_direntplus *childs = new fs_direntplus[listPage];
   if (!childs) {
     return;
   }
-  memset((void *)childs, 0, sizeof(struct fs_dirent) * num);
 
-  bool ret = fsEngine->getFileChildsList(ino, childs, num);
-  if (!ret) {
-    goto createFileDentListExit;
-  }
+  /*
+   * Fetch childs page by page, instead of counting them first
+   */
+  do {
+    memset((void *)childs, 0, sizeof(struct fs_direntplus) * listPage);
 
-  for (int i = static_cast<int> (num) - 1; i >= 0; --i) {
-    list << childs[i];
-  }
+    bool ret = fsEngine->getFileChildsListPlus(ino, &cursor, childs, listPage, &num);
+    if (!ret) {
+      break;
+    }
 
-createFileDentListExit:
+    for (unsigned int i = 0; i < num; ++i) {
+      dentList.prepend(childs[i].dirent);
+      statList.prepend(childs[i].stat);
+    }
+  } while (num == listPage);
 
   if (childs) {
     delete[] childs;
@@ -1527,13 +1546,6 @@ createFileDentListExit:
   }
 }
 
-void MainWindow::createFileStatList(QList<struct fs_dirent> &dentList, QList<struct fs_kstat> &statList)
-{
-  for (int i = 0; i < dentList.size(); ++i) {
-    statList << fsEngine->getFileChildsStat((unsigned long long)dentList[i].d_ino);
-  }
-}
-
 void MainWindow::createTreeRoot(const char *name, unsigned long long ino)
 {
   QStringList stringList;
@@ -1659,10 +1671,8 @@ void MainWindow::expandTreeItem(const QModelIndex &index)
   unsigned long long ino = treeModel->data(index, TREE_INO, Qt::DisplayRole).toULongLong();
 
   treeFileDentList.clear();
-  createFileDentList(ino, treeFileDentList);
-
   treeFileStatList.clear();
-  createFileStatList(treeFileDentList, treeFileStatList);
+  createFileList(ino, treeFileDentList, treeFileStatList);
 
   createTreeItem(treeFileDentList);
 }
@@ -1670,10 +1680,8 @@ void MainWindow::expandTreeItem(const QModelIndex &index)
 void MainWindow::expandListItem(unsigned long long ino)
 {
   listFileDentList.clear();
-  createFileDentList(ino, listFileDentList);
-
   listFileStatList.clear();
-  createFileStatList(listFileDentList, listFileStatList);
+  createFileList(ino, listFileDentList, listFileStatList);
 
   createListItem(listFileDentList, listFileStatList);
 }
@@ -156,8 +156,7 @@ private:
   void showTreeAddress(const QModelIndex &index) const;
   void showFileStat(unsigned long long ino) const;
 
-  void createFileDentList(unsigned long long ino, QList<struct fs_dirent> &list);
-  void createFileStatList(QList<struct fs_dirent> &dentList, QList<struct fs_kstat> &statList);
+  void createFileList(unsigned long long ino, QList<struct fs_dirent> &dentList, QList<struct fs_kstat> &statList);
   void createTreeRoot(const char *name, unsigned long long ino);
   void createTreeItem(const QList<struct fs_dirent> &list);
   void createListItem(const QList<struct fs_dirent> &dentList, const QList<struct fs_kstat> &statList);
@@ -177,6 +176,7 @@ private:
   static const QString version;
   static const QString separator;
   static const QString label;
+  static const unsigned int listPage;
 
   QThread *thread;
   QSettings *settings;
@@ -37,6 +37,8 @@ FS_DNAME_LEN = 256
 FS_DNAME_DOT = '.'
 FS_DNAME_DOTDOT = '..'
 
+FS_IOSTATS_LAT_NUM = 16
+
 
 class libfs_ftype:
     FT_UNKNOWN  = 0
@@ -124,16 +126,38 @@ class fs_dirent(Structure):
                 ('padding1', c_uint8 * 4)]
 
 
+class fs_direntplus(Structure):
+    _fields_ = [('dirent', fs_dirent),
+                ('stat', fs_kstat)]
+
+
+class fs_iostats(Structure):
+    _fields_ = [('reads', c_uint64),
+                ('seeks', c_uint64),
+                ('bytes', c_uint64),
+                ('cache_hits', c_uint64),
+                ('cache_misses', c_uint64),
+                ('lat', c_uint64 * FS_IOSTATS_LAT_NUM),
+                ('mem', c_uint64),
+                ('mem_budget', c_uint64),
+                ('evicts', c_uint64)]
+
+
 class fs_opt_t(Structure):
-    _fields_ = [('mount', CFUNCTYPE(c_int32, c_char_p, c_char_p, c_char_p, c_int32, POINTER(fs_dirent))),
-                ('umount', CFUNCTYPE(c_int32, c_char_p, c_int32)),
-                ('statfs', CFUNCTYPE(c_int32, c_char_p, POINTER(fs_kstatfs))),
-                ('statrawfs', CFUNCTYPE(c_int32, c_char_p, POINTER(c_char_p))),
-                ('stat', CFUNCTYPE(c_int32, c_uint64, POINTER(fs_kstat))),
-                ('statraw', CFUNCTYPE(c_int32, c_uint64, POINTER(c_char_p))),
-                ('querydent', CFUNCTYPE(c_int32, c_uint64, POINTER(fs_dirent))),
-                ('getdents', CFUNCTYPE(c_int32, c_uint64, POINTER(fs_dirent), c_uint)),
-                ('readfile', CFUNCTYPE(c_int32, c_uint64, c_int64, c_char_p, c_int64, POINTER(c_int64)))]
+    _fields_ = [('mount', CFUNCTYPE(c_int32, c_char_p, c_char_p, c_char_p, c_int32, POINTER(fs_dirent), POINTER(c_void_p))),
+                ('umount', CFUNCTYPE(c_int32, c_void_p, c_char_p, c_int32)),
+                ('statfs', CFUNCTYPE(c_int32, c_void_p, c_char_p, POINTER(fs_kstatfs))),
+                ('statrawfs', CFUNCTYPE(c_int32, c_void_p, c_char_p, POINTER(c_char_p))),
+                ('stat', CFUNCTYPE(c_int32, c_void_p, c_uint64, POINTER(fs_kstat))),
+                ('statraw', CFUNCTYPE(c_int32, c_void_p, c_uint64, POINTER(c_char_p))),
+                ('querydent', CFUNCTYPE(c_int32, c_void_p, c_uint64, POINTER(fs_dirent))),
+                ('getdents', CFUNCTYPE(c_int32, c_void_p, c_uint64, POINTER(fs_dirent), c_uint)),
+                ('readfile', CFUNCTYPE(c_int32, c_void_p, c_uint64, c_int64, c_char_p, c_int64, POINTER(c_int64))),
+                ('iostats', CFUNCTYPE(c_int32, c_void_p, c_char_p, POINTER(fs_iostats))),
+                ('readdirplus', CFUNCTYPE(c_int32, c_void_p, c_uint64, POINTER(c_uint64), POINTER(fs_direntplus), c_uint32, POINTER(c_uint32))),
+                ('readdir', CFUNCTYPE(c_int32, c_void_p, c_uint64, POINTER(c_uint64), POINTER(fs_dirent), c_uint32, POINTER(c_uint32))),
+                ('lookup', CFUNCTYPE(c_int32, c_void_p, c_uint64, c_char_p, POINTER(fs_dirent))),
+                ('resolve', CFUNCTYPE(c_int32, c_void_p, c_char_p, POINTER(fs_dirent)))]
 
 
 def dump_fs_map(fsmap, mapfile):
@@ -149,15 +173,10 @@ def postproc_fs_map(fsmap):
     return fsmap
 
 
-def fill_fs_map(fsopt, fspath, fsdirent, fsmap):
+def fill_fs_map(fspath, fsdirent, fsstat, fsmap):
     if fsdirent.d_type != libfs_ftype.FT_REG_FILE:
         return
 
-    fsstat = fs_kstat()
-    ret = fsopt.stat(fsdirent.d_ino, byref(fsstat))
-    if ret != 0:
-        return
-
     if fsstat.size == 0:
         return
 
@@ -166,41 +185,44 @@ def fill_fs_map(fsopt, fspath, fsdirent, fsmap):
     fsmap.append('%s %s' % (fspath + '/' + fsdirent.d_name, blocklist))
 
 
-def traverse_fs_dents(fsopt, fsino, fspath, fsmap):
+def traverse_fs_dents(fsopt, fssession, fsino, fspath, fsmap):
     fsdirent = fs_dirent()
-    ret = fsopt.querydent(fsino, byref(fsdirent))
+    ret = fsopt.querydent(fssession, fsino, byref(fsdirent))
     if ret != 0:
         return
 
     if fsdirent.d_childnum == 0:
         return
 
-    fs_dirents = fs_dirent * fsdirent.d_childnum
-    fsdirents = fs_dirents()
-    ret = fsopt.getdents(fsino, fsdirents, fsdirent.d_childnum)
+    fs_direntsplus = fs_direntplus * fsdirent.d_childnum
+    fsdirentsplus = fs_direntsplus()
+    fscursor = c_uint64(0)
+    fsnum = c_uint32(0)
+    ret = fsopt.readdirplus(fssession, fsino, byref(fscursor), fsdirentsplus, fsdirent.d_childnum, byref(fsnum))
     if ret != 0:
         return
 
-    for i in range(fsdirent.d_childnum):
-        d_name = fsdirents[i].d_name
+    for i in range(fsnum.value):
+        d_name = fsdirentsplus[i].dirent.d_name
         if d_name == FS_DNAME_DOT or d_name == FS_DNAME_DOTDOT:
             continue
 
-        fill_fs_map(fsopt, fspath, fsdirents[i], fsmap)
+        fill_fs_map(fspath, fsdirentsplus[i].dirent, fsdirentsplus[i].stat, fsmap)
 
         path = fspath
         path += '/' + d_name
-        traverse_fs_dents(fsopt, fsdirents[i].d_ino, path, fsmap)
+        traverse_fs_dents(fsopt, fssession, fsdirentsplus[i].dirent.d_ino, path, fsmap)
 
 
-def build_fs_map_helper(fsopt, fsroot):
+def build_fs_map_helper(fsopt, fssession, fsroot):
     fsmap = []
-    traverse_fs_dents(fsopt, fsroot.d_ino, '/system', fsmap)
+    traverse_fs_dents(fsopt, fssession, fsroot.d_ino, '/system', fsmap)
     return fsmap
 
 
 def build_fs_map(fsfile):
     fsopt = fs_opt_t()
+    fssession = c_void_p()
     fsroot = fs_dirent()
 
     lib_handle = load_fs_library()
@@ -213,12 +235,12 @@ def build_fs_map(fsfile):
     if ret != 0:
         return None
 
-    ret = fsopt.mount(c_char_p(fsfile), 'mnt', FS_TYPE_EXT4, 0, byref(fsroot))
+    ret = fsopt.mount(c_char_p(fsfile), 'mnt', FS_TYPE_EXT4, 0, byref(fsroot), byref(fssession))
     if ret != 0:
         return None
 
-    fsmap = build_fs_map_helper(fsopt, fsroot)
-    fsopt.umount('mnt', 0)
+    fsmap = build_fs_map_helper(fsopt, fssession, fsroot)
+    fsopt.umount(fssession, 'mnt', 0)
 
     return fsmap
 
@@ -0,0 +1,189 @@
+/**
+ * arena.h - The header of arena and slab allocator.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_INCLUDE_BASE_ARENA
+#endif
+
+#include "include/base/types.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * Size of chunk allocated by arena at a time
+ */
+#define ARENA_CHUNK_SZ  (64 * 1024)
+
+/*
+ * Alignment of memory allocated by arena
+ */
+#define ARENA_ALIGN  (8)
+
+/*
+ * Type Definition
+ */
+/*
+ * Header of chunk, followed by memory allocated
+ */
+struct arena_chunk {
+  struct arena_chunk *next;
+  uint64_t pad;
+};
+
+/*
+ * Arena of memory allocated in chunks, and freed all at once
+ * Zeroed arena is valid and empty
+ */
+struct arena {
+  struct arena_chunk *chunks;
+  uint8_t *ptr;
+  uint32_t left;
+  uint64_t size;
+};
+
+/*
+ * Slab of objects of fixed size, backed by arena,
+ * with objects freed put on free list for reuse
+ */
+struct slab {
+  struct arena arena;
+  uint32_t obj_sz;
+  uint32_t obj_num;
+  void *free;
+};
+
+/*
+ * Function Declaration
+ */
+/*
+ * Allocate memory of len from arena, which is not zeroed
+ */
+static inline void* arena_alloc(struct arena *arena, uint32_t len)
+{
+  struct arena_chunk *chunk = NULL;
+  uint32_t sz;
+  void *ptr;
+
+  len = (len + ARENA_ALIGN - 1) & ~(uint32_t)(ARENA_ALIGN - 1);
+
+  if (len > arena->left) {
+    /*
+     * Allocate chunk of its own for large memory,
+     * and keep on allocating from current chunk
+     */
+    sz = len > ARENA_CHUNK_SZ / 4 ? len : ARENA_CHUNK_SZ;
+
+    chunk = (struct arena_chunk *)malloc(sizeof(struct arena_chunk) + sz);
+    if (!chunk) {
+      return NULL;
+    }
+
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->size += sizeof(struct arena_chunk) + sz;
+
+    if (sz != ARENA_CHUNK_SZ) {
+      return (void *)(chunk + 1);
+    }
+
+    arena->ptr = (uint8_t *)(chunk + 1);
+    arena->left = sz;
+  }
+
+  ptr = (void *)arena->ptr;
+  arena->ptr += len;
+  arena->left -= len;
+
+  return ptr;
+}
+
+/*
+ * Free all memory of arena
+ */
+static inline void arena_release(struct arena *arena)
+{
+  struct arena_chunk *chunk = NULL;
+
+  while (arena->chunks) {
+    chunk = arena->chunks;
+    arena->chunks = chunk->next;
+    free((void *)chunk);
+  }
+
+  memset((void *)arena, 0, sizeof(struct arena));
+}
+
+static inline void slab_init(struct slab *slab, uint32_t obj_sz)
+{
+  memset((void *)slab, 0, sizeof(struct slab));
+  slab->obj_sz = obj_sz > sizeof(void *) ? obj_sz : sizeof(void *);
+}
+
+/*
+ * Allocate zeroed object from slab
+ */
+static inline void* slab_alloc(struct slab *slab)
+{
+  void *obj = NULL;
+
+  if (slab->free) {
+    obj = slab->free;
+    slab->free = *(void **)obj;
+  } else {
+    obj = arena_alloc(&slab->arena, slab->obj_sz);
+    if (!obj) {
+      return NULL;
+    }
+  }
+
+  memset(obj, 0, slab->obj_sz);
+  slab->obj_num += 1;
+
+  return obj;
+}
+
+static inline void slab_free(struct slab *slab, void *obj)
+{
+  *(void **)obj = slab->free;
+  slab->free = obj;
+  slab->obj_num -= 1;
+}
+
+/*
+ * Free all objects of slab
+ */
+static inline void slab_release(struct slab *slab)
+{
+  arena_release(&slab->arena);
+  slab->obj_num = 0;
+  slab->free = NULL;
+}
+
+#endif /* _ARENA_H */
@@ -0,0 +1,195 @@
+/**
+ * lock.h - The header of mutex and reader-writer lock.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LOCK_H
+#define _LOCK_H
+
+#include "config.h"
+#include <stdint.h>
+#ifdef CMAKE_COMPILER_IS_GNUCC
+#include <pthread.h>
+#else
+#include <windows.h>
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+#ifdef DEBUG
+#define DEBUG_INCLUDE_BASE_LOCK
+#endif
+
+#include "include/base/types.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * Storage of variable per thread
+ */
+#ifdef CMAKE_COMPILER_IS_GNUCC
+#define THREAD_LOCAL  __thread
+#else
+#define THREAD_LOCAL  __declspec(thread)
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+/*
+ * Type Definition
+ */
+#ifdef CMAKE_COMPILER_IS_GNUCC
+struct mutex {
+  pthread_mutex_t lock;
+};
+
+struct rwlock {
+  pthread_rwlock_t lock;
+};
+#else
+struct mutex {
+  SRWLOCK lock;
+};
+
+struct rwlock {
+  SRWLOCK lock;
+};
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+/*
+ * Function Declaration
+ */
+static inline int32_t mutex_init(struct mutex *mutex)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  return pthread_mutex_init(&mutex->lock, NULL) == 0 ? 0 : -1;
+#else
+  InitializeSRWLock(&mutex->lock);
+  return 0;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline void mutex_destroy(struct mutex *mutex)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_mutex_destroy(&mutex->lock);
+#else
+  mutex = mutex;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline void mutex_lock(struct mutex *mutex)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_mutex_lock(&mutex->lock);
+#else
+  AcquireSRWLockExclusive(&mutex->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline void mutex_unlock(struct mutex *mutex)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_mutex_unlock(&mutex->lock);
+#else
+  ReleaseSRWLockExclusive(&mutex->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline int32_t rwlock_init(struct rwlock *rwlock)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  return pthread_rwlock_init(&rwlock->lock, NULL) == 0 ? 0 : -1;
+#else
+  InitializeSRWLock(&rwlock->lock);
+  return 0;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline void rwlock_destroy(struct rwlock *rwlock)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_rwlock_destroy(&rwlock->lock);
+#else
+  rwlock = rwlock;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+/*
+ * Lock shared by readers
+ */
+static inline void read_lock(struct rwlock *rwlock)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_rwlock_rdlock(&rwlock->lock);
+#else
+  AcquireSRWLockShared(&rwlock->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline void read_unlock(struct rwlock *rwlock)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_rwlock_unlock(&rwlock->lock);
+#else
+  ReleaseSRWLockShared(&rwlock->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+/*
+ * Lock exclusive to writer
+ */
+static inline void write_lock(struct rwlock *rwlock)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_rwlock_wrlock(&rwlock->lock);
+#else
+  AcquireSRWLockExclusive(&rwlock->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline void write_unlock(struct rwlock *rwlock)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  (void)pthread_rwlock_unlock(&rwlock->lock);
+#else
+  ReleaseSRWLockExclusive(&rwlock->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+/*
+ * Load & store of value shared by threads without lock held,
+ * e.g., hint set by readers with read lock held
+ */
+static inline uint32_t atomic_load32(volatile uint32_t *ptr)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+#else
+  return (uint32_t)InterlockedCompareExchange((volatile LONG *)ptr, 0, 0);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static inline void atomic_store32(volatile uint32_t *ptr, uint32_t val)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  __atomic_store_n(ptr, val, __ATOMIC_RELAXED);
+#else
+  (void)InterlockedExchange((volatile LONG *)ptr, (LONG)val);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+#endif /* _LOCK_H */
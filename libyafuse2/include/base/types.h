@@ -145,6 +145,11 @@ static inline void list_add(struct list_head *new, struct list_head *head)
   __list_add(new, head, head->next);
 }
 
+static inline void list_add_tail(struct list_head *new, struct list_head *head)
+{
+  __list_add(new, head->prev, head);
+}
+
 static inline void __list_del(struct list_head *prev, struct list_head *next)
 {
   next->prev = prev;
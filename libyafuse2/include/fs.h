@@ -31,11 +31,14 @@
 #endif
 
 #include "include/base/types.h"
+#include "include/base/arena.h"
 
 /*
  * Macro Definition
  */
 #define DNAME_ROOT "/"
+#define DNAME_DOT "."
+#define DNAME_DOTDOT ".."
 
 #define DNAME_INLINE_LEN 40
 
@@ -48,12 +51,14 @@ struct qstr;
 struct fs_timespec;
 struct vfsmount;
 struct mount;
+struct mount_data;
 struct fsid_t;
 struct kstatfs;
 struct kstat;
 struct path;
 struct file;
 struct iattr;
+struct extent_status;
 struct dentry;
 struct inode;
 struct super_block;
@@ -62,6 +67,7 @@ struct dentry_operations;
 struct inode_operations;
 struct super_operations;
 struct file_operations;
+struct io_ctx;
 
 struct qstr {
   uint32_t hash;
@@ -88,6 +94,17 @@ struct mount {
   const char *mnt_devname;
 };
 
+/*
+ * New added
+ * Options of mount, passed as data of file_system_type.mount
+ */
+struct mount_data {
+  bool md_nocache;
+  uint32_t md_cache_blks;
+  bool md_direct;
+  uint64_t md_mem_budget;
+};
+
 struct fsid_t {
   int32_t val[2];
 };
@@ -149,6 +166,18 @@ struct iattr {
   struct file *ia_file;
 };
 
+/*
+ * New added
+ * Extent of file mapping logical blocks to physical ones,
+ * refer to type of 'extent_status' in kernel/fs/ext4/extents_status.h
+ */
+struct extent_status {
+  uint32_t es_lblk;
+  uint32_t es_len;
+  uint64_t es_pblk;
+  bool es_unwritten;
+};
+
 struct dentry {
   struct dentry                  *d_parent;
   struct qstr                    *d_name;
@@ -158,6 +187,43 @@ struct dentry {
   struct list_head               d_child;
   struct list_head               d_subdirs;
   uint32_t                       d_childnum;
+
+  /*
+   * New added
+   * Node in list of dentries of inode, for hard links
+   */
+  struct list_head               d_alias;
+
+  /*
+   * New added
+   * Index of next block of directory to traverse,
+   * and set once all blocks are traversed
+   */
+  uint64_t                       d_pos;
+  bool                           d_complete;
+
+  /*
+   * New added
+   * Node in bucket of hash table of dentries keyed by parent and name
+   */
+  struct list_head               d_hash;
+
+  /*
+   * New added
+   * Node in LRU list of directories with child dentries but not child directories
+   * with them, number of such child directories, and set once accessed in list
+   */
+  struct list_head               d_lru;
+  uint32_t                       d_dirnum;
+  uint32_t                       d_referenced;
+
+  /*
+   * New added
+   * List of child dentries looked up by index of directory, ahead of traversal,
+   * and set while dentry is in list of parent, till traversal reaches it
+   */
+  struct list_head               d_lookups;
+  bool                           d_indexed;
 };
 
 struct inode {
@@ -173,7 +239,6 @@ struct inode {
   struct fs_timespec            i_ctime;
   uint64_t                      i_blocks;
   int64_t                       i_size;
-  struct list_head              i_sb_list;
   uint32_t                      i_count;
   uint64_t                      i_version;
   const struct file_operations  *i_fop;
@@ -184,6 +249,36 @@ struct inode {
    */
   uint32_t                      *i_block;
   int32_t                       i_block_num;
+
+  /*
+   * New added
+   * List of dentries of inode, except for '.' and '..'
+   */
+  struct list_head              i_dentry;
+
+  /*
+   * New added
+   * Set while inode is not read from disk yet,
+   * with ino and type of file in i_mode only
+   */
+  bool                          i_new;
+
+  /*
+   * New added
+   * Node in LRU list of inodes without dentries, e.g., read from disk by ino
+   * after evicted along with dentries, and set once accessed in list
+   */
+  struct list_head              i_lru;
+  uint32_t                      i_referenced;
+
+  /*
+   * New added
+   * Extents of file flattened from extent tree, sorted by logical block,
+   * and set once they are mapped, on first read of file
+   */
+  struct extent_status          *i_es;
+  uint32_t                      i_es_num;
+  bool                          i_mapped;
 };
 
 struct super_block {
@@ -196,18 +291,73 @@ struct super_block {
   uint64_t                       s_magic;
   struct dentry                  *s_root;
   int32_t                        s_count;
-  struct list_head               s_inodes;
   char                           s_id[32];
   uint8_t                        s_uuid[16];
   void                           *s_fs_info;
   const struct dentry_operations *s_d_op;
+
+  /*
+   * New added
+   * Handle of IO for filesystem image
+   */
+  struct io_ctx                  *s_io;
+
+  /*
+   * New added
+   * Open-addressing hash table of inodes keyed by ino,
+   * with number of slots of power of 2, and number of inodes in it
+   */
+  struct inode                   **s_inodes;
+  uint32_t                       s_inodes_mask;
+  uint32_t                       s_inodes_num;
+
+  /*
+   * New added
+   * Chained hash table of dentries keyed by parent and hash of name,
+   * with number of buckets of power of 2, and number of dentries in it
+   */
+  struct list_head               *s_dentries;
+  uint32_t                       s_dentries_mask;
+  uint32_t                       s_dentries_num;
+
+  /*
+   * New added
+   * Slabs of dentries with short names following them, inodes, and long names,
+   * freed all at once at umount
+   */
+  struct slab                    s_dentry_slab;
+  struct slab                    s_inode_slab;
+  struct slab                    s_name_slab;
+
+  /*
+   * New added
+   * LRU lists of directories and inodes to evict, to keep memory of dentries
+   * and inodes within budget in bytes, 0 for unlimited, and number evicted
+   */
+  struct list_head               s_dentry_lru;
+  struct list_head               s_inode_lru;
+  uint64_t                       s_mem_budget;
+  uint64_t                       s_evicts;
+
+  /*
+   * New added
+   * Ino of directory traversed last, kept by pruning with no directory pinned,
+   * till thread traversing it takes it after write lock is released
+   */
+  uint64_t                       s_traversed;
+
+  /*
+   * New added
+   * Bytes of extents mapped on inodes
+   */
+  uint64_t                       s_es_mem;
 };
 
 struct file_system_type {
   const char *name;
   int32_t fs_flags;
   struct dentry* (*mount) (struct file_system_type *type, uint64_t flags, const char *name, void *data);
-  int32_t (*umount) (const char *name, int32_t flags);
+  int32_t (*umount) (struct super_block *sb, int32_t flags);
 };
 
 struct dentry_operations {
@@ -240,11 +390,20 @@ struct inode_operations {
 struct super_operations {
   struct inode* (*alloc_inode) (struct super_block *);
   void (*destroy_inode) (struct inode *);
-  int32_t (*traverse_dentry)(struct dentry **);
+  int32_t (*traverse_dentry)(struct dentry **, uint32_t);
   int32_t (*statfs) (struct dentry *, struct kstatfs *);
   int32_t (*statrawfs) (struct dentry *, const char **);
   int32_t (*statraw) (struct inode *, const char **);
-}; 
+  struct inode* (*find_inode) (struct super_block *, uint64_t);
+  struct dentry* (*find_dentry) (struct dentry *, const char *, uint32_t);
+  int32_t (*read_inode) (struct inode *);
+  struct inode* (*iget) (struct super_block *, uint64_t);
+  int32_t (*get_parent) (struct super_block *, uint64_t, uint64_t *);
+  int32_t (*prune) (struct super_block *, struct dentry *, struct inode *);
+  uint64_t (*mem_used) (struct super_block *);
+  int32_t (*map_inode) (struct inode *);
+  int32_t (*lookup_dentry) (struct dentry *, const char *, uint32_t, struct dentry **);
+};
 
 struct file_operations {
   int64_t (*llseek) (struct file *, int64_t, int32_t);
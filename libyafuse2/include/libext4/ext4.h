@@ -215,6 +215,7 @@ struct ext4_group_desc_min
 #define EXT4_EXTENTS_FL 0x00080000  
 #define EXT4_EA_INODE_FL 0x00200000  
 #define EXT4_EOFBLOCKS_FL 0x00400000  
+#define EXT4_INLINE_DATA_FL 0x10000000  
 #define EXT4_RESERVED_FL 0x80000000  
 
 #define EXT4_FL_USER_VISIBLE 0x004BDFFF  
@@ -680,4 +681,14 @@ struct ext4_dir_entry_2 {
 #define DX_HASH_HALF_MD4_UNSIGNED 4
 #define DX_HASH_TEA_UNSIGNED 5
 
+struct dx_hash_info
+{
+ u32 hash;
+ u32 minor_hash;
+ int hash_version;
+ u32 *seed;
+};
+
+#define EXT4_HTREE_EOF_32BIT ((1UL << (32 - 1)) - 1)
+
 #endif
@@ -62,17 +62,28 @@ void ext4_show_stat_dentry(struct ext4_dir_entry_2 *dentry, char *buf, int32_t b
 int32_t ext4_raw_file(struct inode *inode, int64_t offset, char *buf, size_t buf_len, int64_t *read_len);
 int32_t ext4_raw_link(struct inode *inode, int64_t offset, char *buf, size_t buf_len, int64_t *read_len);
 
-int32_t ext4_raw_dentry_num(struct dentry *parent, uint32_t *childs_num);
-int32_t ext4_raw_dentry(struct dentry *parent, struct ext4_dir_entry_2 *childs, uint32_t childs_num);
+int32_t ext4_raw_dir_block(struct inode *inode, uint64_t blk, uint8_t **data, const uint8_t **block);
+int32_t ext4_raw_dentry_block(struct inode *inode, uint64_t blk, struct ext4_dir_entry_2 *childs, uint32_t childs_max, uint32_t *childs_num);
+int32_t ext4_find_dentry_block(struct inode *inode, const uint8_t *block, const char *name, uint32_t len, struct ext4_dir_entry_2 *dentry);
+int32_t ext4_dx_find_dentry(struct inode *inode, const char *name, uint32_t len, struct ext4_dir_entry_2 *dentry);
+
+int32_t ext4fs_dirhash(const char *name, int32_t len, struct dx_hash_info *hinfo);
 
 int32_t ext4_ext_header_check(struct inode *inode);
-int32_t ext4_ext_node_header(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_extent_header *eh);
+const uint8_t* ext4_ext_node_block(struct inode *inode, struct ext4_extent_idx *ei, uint8_t *blk, uint32_t *node_len);
+int32_t ext4_ext_node_header(const uint8_t *node, uint32_t node_len, int32_t depth, struct ext4_extent_header *eh);
 int32_t ext4_ext_node_is_leaf(struct ext4_extent_header *eh);
 int32_t ext4_ext_node_num(struct ext4_extent_header *eh, uint16_t *nodes_num);
-int32_t ext4_ext_index_node(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_extent_idx *nodes, uint16_t nodes_num);
-int32_t ext4_ext_leaf_node(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_extent *nodes, uint16_t nodes_num);
+int32_t ext4_ext_index_node(const uint8_t *node, struct ext4_extent_idx *nodes, uint16_t nodes_num);
+int32_t ext4_ext_leaf_node(const uint8_t *node, struct ext4_extent *nodes, uint16_t nodes_num);
+int32_t ext4_ext_map(struct inode *inode, struct extent_status **es, uint32_t *es_num);
+uint32_t ext4_ext_map_find(const struct extent_status *es, uint32_t es_num, uint64_t lblk);
+int32_t ext4_ext_map_blk(struct inode *inode, uint64_t lblk, uint64_t *pblk);
+
+int32_t ext4_ind_map(struct inode *inode, struct extent_status **es, uint32_t *es_num);
 
 int32_t ext4_raw_inode(struct super_block *sb, uint64_t ino, struct ext4_inode *inode);
+int32_t ext4_map_blocks(struct inode *inode, struct extent_status **es, uint32_t *es_num);
 
 int32_t ext4_bg_has_super(struct super_block *sb, ext4_group_t bg);
 
@@ -83,6 +94,6 @@ int32_t ext4_raw_group_desc(struct super_block *sb, uint32_t bg_cnt, struct ext4
 #endif
 
 int32_t ext4_fill_super_info(struct super_block *sb, struct ext4_super_block *es, struct ext4_sb_info *info);
-int32_t ext4_raw_super(struct ext4_super_block *es);
+int32_t ext4_raw_super(struct super_block *sb, struct ext4_super_block *es);
 
 #endif /* _LIBEXT4_H */
@@ -35,18 +35,91 @@
 /*
  * Macro Definition
  */
+/*
+ * Default number of blocks in cache
+ */
+#define IO_CACHE_BLKS_DEF  (1024)
+
+/*
+ * Number of buckets of latency histogram
+ */
+#define IO_STAT_LAT_NUM  (16)
 
 /*
  * Type Definition
  */
+struct io_ctx;
+
+struct io_vec {
+  uint8_t *data;
+  int64_t len;
+};
+
+/*
+ * Counters of IO:
+ * reads issued to file, i.e., syscalls, copies from mapping or ops of io_uring,
+ * seeks, bytes read, hits & misses of cache,
+ * and latency histogram, bucket i counting samples shorter than 2^i us
+ * and the last one the rest, where a batch of io_uring is one sample
+ */
+struct io_stat {
+  uint64_t reads;
+  uint64_t seeks;
+  uint64_t bytes;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t lat[IO_STAT_LAT_NUM];
+};
+
+struct io_req {
+  int64_t offset;
+  uint8_t *data;
+  int64_t len;
+  int64_t ret;
+};
+
+/*
+ * Operations of backend, with priv as private data of backend
+ * pread returns length of read, which is short only at the end of device,
+ * and all operations but close & pread are optional
+ */
+struct io_ops {
+  const char *name;
+  void (*close) (void *priv);
+  int64_t (*pread) (void *priv, int64_t offset, uint8_t *data, int64_t len);
+  int64_t (*pwrite) (void *priv, int64_t offset, const uint8_t *data, int64_t len);
+  int64_t (*preadv) (void *priv, int64_t offset, const struct io_vec *vecs, uint32_t num);
+  int32_t (*pread_batch) (void *priv, struct io_req *reqs, uint32_t num);
+  const uint8_t* (*map) (void *priv, int64_t offset, int64_t len);
+  void (*advise) (void *priv, int64_t offset, int64_t len);
+  int32_t (*direct) (void *priv, bool enable);
+  void (*stat) (void *priv, struct io_stat *stat);
+};
 
 /*
  * Function Declaration
  */
-int32_t io_open(const char *fs_name);
-void io_close(void);
-int32_t io_seek(int64_t offset);
-int32_t io_read(uint8_t *data, int64_t len);
-int32_t io_write(uint8_t *data, int64_t len);
+struct io_ctx* io_open(const char *fs_name);
+struct io_ctx* io_open_ops(const struct io_ops *ops, void *priv, int64_t size);
+struct io_ctx* io_open_file(const char *fs_name);
+struct io_ctx* io_open_mem(const uint8_t *buf, int64_t len);
+struct io_ctx* io_open_range(struct io_ctx *parent, int64_t offset, int64_t len);
+struct io_ctx* io_open_sparse(struct io_ctx *parent);
+struct io_ctx* io_open_segs(const char * const *names, uint32_t num);
+struct io_ctx* io_open_part(struct io_ctx *parent, uint32_t index);
+struct io_ctx* io_open_part_name(struct io_ctx *parent, const char *name);
+void io_close(struct io_ctx *ctx);
+int64_t io_size(struct io_ctx *ctx);
+int64_t io_pread(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len);
+const uint8_t* io_map(struct io_ctx *ctx, int64_t offset, int64_t len);
+int64_t io_pwrite(struct io_ctx *ctx, int64_t offset, const uint8_t *data, int64_t len);
+int64_t io_preadv(struct io_ctx *ctx, int64_t offset, const struct io_vec *vecs, uint32_t num);
+int32_t io_pread_batch(struct io_ctx *ctx, struct io_req *reqs, uint32_t num);
+int32_t io_cache_init(struct io_ctx *ctx, int64_t blksz, uint32_t blks_num);
+void io_cache_exit(struct io_ctx *ctx);
+int32_t io_cache_stat(struct io_ctx *ctx, uint64_t *hits, uint64_t *misses);
+int32_t io_direct_init(struct io_ctx *ctx);
+void io_direct_exit(struct io_ctx *ctx);
+int32_t io_stat(struct io_ctx *ctx, struct io_stat *stat);
 
 #endif /* _IO_H */
@@ -0,0 +1,106 @@
+/**
+ * part.h - The header of partition table for IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PART_H
+#define _PART_H
+
+#include "config.h"
+#include <stdint.h>
+
+#ifdef DEBUG
+#define DEBUG_INCLUDE_LIBIO_PART
+#endif
+
+#include "include/base/types.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * MBR, refer to 'block/partitions/msdos.c' of Linux
+ */
+#define MBR_SECTOR_SZ     (512)
+#define MBR_PART_OFFSET   (0x1BE)
+#define MBR_PART_NUM      (4)
+#define MBR_SIGNATURE     (0xAA55)
+#define MBR_LOGICAL_MIN   (5)
+
+#define MBR_TYPE_EXTENDED      (0x05)
+#define MBR_TYPE_EXTENDED_LBA  (0x0F)
+#define MBR_TYPE_EXTENDED_LNX  (0x85)
+#define MBR_TYPE_GPT           (0xEE)
+
+/*
+ * GPT, refer to 'block/partitions/efi.h' of Linux
+ */
+#define GPT_HEADER_SIGNATURE  ("EFI PART")
+#define GPT_HEADER_SIG_LEN    (8)
+#define GPT_ENTRY_SZ_MIN      (128)
+#define GPT_ENTRY_NAME_LEN    (36)
+#define GPT_ENTRIES_MAX       (1024)
+
+/*
+ * Type Definition
+ */
+struct mbr_partition {
+  __u8 boot_ind;
+  __u8 head;
+  __u8 sector;
+  __u8 cyl;
+  __u8 sys_ind;
+  __u8 end_head;
+  __u8 end_sector;
+  __u8 end_cyl;
+  __le32 start_sect;
+  __le32 nr_sects;
+};
+
+struct gpt_header {
+  __u8 signature[GPT_HEADER_SIG_LEN];
+  __le32 revision;
+  __le32 header_size;
+  __le32 header_crc32;
+  __le32 reserved1;
+  __le64 my_lba;
+  __le64 alternate_lba;
+  __le64 first_usable_lba;
+  __le64 last_usable_lba;
+  __u8 disk_guid[16];
+  __le64 partition_entry_lba;
+  __le32 num_partition_entries;
+  __le32 sizeof_partition_entry;
+  __le32 partition_entry_array_crc32;
+};
+
+struct gpt_entry {
+  __u8 partition_type_guid[16];
+  __u8 unique_partition_guid[16];
+  __le64 starting_lba;
+  __le64 ending_lba;
+  __le64 attributes;
+  __le16 partition_name[GPT_ENTRY_NAME_LEN];
+};
+
+/*
+ * Function Declaration
+ */
+
+#endif /* _PART_H */
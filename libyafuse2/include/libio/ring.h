@@ -0,0 +1,51 @@
+/**
+ * ring.h - The header of io_uring ring for IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RING_H
+#define _RING_H
+
+#include "config.h"
+#include <stdint.h>
+
+#ifdef DEBUG
+#define DEBUG_INCLUDE_LIBIO_RING
+#endif
+
+#include "include/libio/io.h"
+
+/*
+ * Macro Definition
+ */
+#define IO_RING_ENTRIES  (64)
+
+/*
+ * Type Definition
+ */
+struct io_ring;
+
+/*
+ * Function Declaration
+ */
+struct io_ring* io_ring_open(int fd, uint32_t entries);
+void io_ring_close(struct io_ring *ring);
+int32_t io_ring_pread(struct io_ring *ring, struct io_req *reqs, uint32_t num);
+
+#endif /* _RING_H */
@@ -0,0 +1,78 @@
+/**
+ * sparse.h - The header of Android sparse image for IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SPARSE_H
+#define _SPARSE_H
+
+#include "config.h"
+#include <stdint.h>
+
+#ifdef DEBUG
+#define DEBUG_INCLUDE_LIBIO_SPARSE
+#endif
+
+#include "include/base/types.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * Refer to 'system/core/libsparse/sparse_format.h' of Android
+ */
+#define SPARSE_HEADER_MAGIC  (0xed26ff3a)
+
+#define SPARSE_MAJOR_VERSION  (1)
+
+#define SPARSE_FILE_HDR_SZ   (28)
+#define SPARSE_CHUNK_HDR_SZ  (12)
+
+#define CHUNK_TYPE_RAW        (0xCAC1)
+#define CHUNK_TYPE_FILL       (0xCAC2)
+#define CHUNK_TYPE_DONT_CARE  (0xCAC3)
+#define CHUNK_TYPE_CRC32      (0xCAC4)
+
+/*
+ * Type Definition
+ */
+struct sparse_header {
+  __le32 magic;           /* 0xed26ff3a */
+  __le16 major_version;   /* (0x1) - reject images with higher major versions */
+  __le16 minor_version;   /* (0x0) - allow images with higher minor versions */
+  __le16 file_hdr_sz;     /* 28 bytes for first revision of the file format */
+  __le16 chunk_hdr_sz;    /* 12 bytes for first revision of the file format */
+  __le32 blk_sz;          /* block size in bytes, must be a multiple of 4 (4096) */
+  __le32 total_blks;      /* total blocks in the non-sparse output image */
+  __le32 total_chunks;    /* total chunks in the sparse input image */
+  __le32 image_checksum;  /* CRC32 checksum of the original data, counting "don't care" */
+};
+
+struct chunk_header {
+  __le16 chunk_type;      /* 0xCAC1 -> raw; 0xCAC2 -> fill; 0xCAC3 -> don't care */
+  __le16 reserved1;
+  __le32 chunk_sz;        /* in blocks in output image */
+  __le32 total_sz;        /* in bytes of chunk input file including chunk header and data */
+};
+
+/*
+ * Function Declaration
+ */
+
+#endif /* _SPARSE_H */
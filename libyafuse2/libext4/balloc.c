@@ -111,7 +111,7 @@ int32_t ext4_raw_group_desc(struct super_block *sb, ext4_group_t bg, struct ext4
   struct ext4_sb_info *info = (struct ext4_sb_info *)(sb->s_fs_info);
   struct ext4_super_block *es = info->s_es;
   int64_t has_super, offset;
-  int32_t ret;
+  int64_t ret;
 
   /*
    * Ignore the feature of EXT4_FEATURE_INCOMPAT_META_BG
@@ -126,13 +126,8 @@ int32_t ext4_raw_group_desc(struct super_block *sb, ext4_group_t bg, struct ext4
   }
 
   offset = has_super + (int64_t)(ext4_group_first_block_no(sb, bg));
-  ret = io_seek((int64_t)(offset * sb->s_blocksize));
-  if (ret != 0) {
-    return -1;
-  }
-
-  ret = io_read((uint8_t *)gdp, (int64_t)EXT4_DESC_SIZE(es));
-  if (ret != 0) {
+  ret = io_pread(sb->s_io, (int64_t)(offset * sb->s_blocksize), (uint8_t *)gdp, (int64_t)EXT4_DESC_SIZE(es));
+  if (ret != (int64_t)EXT4_DESC_SIZE(es)) {
     return -1;
   }
 
@@ -149,9 +144,8 @@ int32_t ext4_raw_group_desc(struct super_block *sb, uint32_t bg_cnt, struct ext4
 {
   struct ext4_sb_info *info = (struct ext4_sb_info *)(sb->s_fs_info);
   struct ext4_super_block *es = info->s_es;
-  int64_t has_super, offset;
+  int64_t has_super, offset, len;
   uint32_t i;
-  int32_t ret;
 
   /*
    * Ignore the feature of EXT4_FEATURE_INCOMPAT_META_BG
@@ -164,13 +158,8 @@ int32_t ext4_raw_group_desc(struct super_block *sb, uint32_t bg_cnt, struct ext4
       has_super = 1;
 
       offset = has_super + (int64_t)(ext4_group_first_block_no(sb, i));
-      ret = io_seek((int64_t)(offset * sb->s_blocksize));
-      if (ret != 0) {
-        return -1;
-      }
-
-      ret = io_read((uint8_t *)gdp, (int64_t)(EXT4_DESC_SIZE(es) * bg_cnt));
-      if (ret != 0) {
+      len = (int64_t)(EXT4_DESC_SIZE(es) * bg_cnt);
+      if (io_pread(sb->s_io, (int64_t)(offset * sb->s_blocksize), (uint8_t *)gdp, len) != len) {
         return -1;
       }
 
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 
 #ifdef DEBUG
 #define DEBUG_LIBEXT4_DEBUG
@@ -41,6 +42,11 @@
  */
 #define EXT4_DUMMY_STR  "<none>"
 
+/*
+ * Length of string of time by ctime, with '\n' and '\0'
+ */
+#define EXT4_CTIME_LEN  (26)
+
 /*
  * Type Definition
  */
@@ -52,16 +58,37 @@
 /*
  * Function Declaration
  */
+static const char* ext4_ctime(const time_t *tm, char *str);
 
 /*
  * Function Definition
  */
+/*
+ * Convert time into string as ctime, but in buffer of caller,
+ * as stats may be shown for mounts in threads at the same time
+ */
+static const char* ext4_ctime(const time_t *tm, char *str)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  if (!ctime_r(tm, str)) {
+    return EXT4_DUMMY_STR "\n";
+  }
+#else
+  if (ctime_s(str, EXT4_CTIME_LEN, tm) != 0) {
+    return EXT4_DUMMY_STR "\n";
+  }
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+  return str;
+}
+
 void ext4_show_stat_sb(struct ext4_super_block *sb, char *buf, int32_t buf_len)
 {
   int32_t i = 0;
   uint32_t val = 0;
   const char *str = NULL;
   time_t tm = 0;
+  char tm_str[EXT4_CTIME_LEN];
   int32_t len = 0;
 
   len = snprintf(buf, buf_len, "Total inode count : %u\n", sb->s_inodes_count);
@@ -96,7 +123,7 @@ void ext4_show_stat_sb(struct ext4_super_block *sb, char *buf, int32_t buf_len)
   buf += len;
   if (sb->s_mtime != 0) {
     tm = (time_t)sb->s_mtime;
-    len = snprintf(buf, buf_len, "%s", ctime(&tm));
+    len = snprintf(buf, buf_len, "%s", ext4_ctime(&tm, tm_str));
     buf += len;
   } else {
     len = snprintf(buf, buf_len, EXT4_DUMMY_STR);
@@ -109,7 +136,7 @@ void ext4_show_stat_sb(struct ext4_super_block *sb, char *buf, int32_t buf_len)
   buf += len;
   if (sb->s_wtime != 0) {
     tm = (time_t)sb->s_wtime;
-    len = snprintf(buf, buf_len, "%s", ctime(&tm));
+    len = snprintf(buf, buf_len, "%s", ext4_ctime(&tm, tm_str));
     buf += len;
   } else {
     len = snprintf(buf, buf_len, EXT4_DUMMY_STR);
@@ -578,7 +605,7 @@ void ext4_show_stat_sb(struct ext4_super_block *sb, char *buf, int32_t buf_len)
     buf += len;
     if (sb->s_mkfs_time != 0) {
       tm = (time_t)sb->s_mkfs_time;
-      len = snprintf(buf, buf_len, "%s", ctime(&tm));
+      len = snprintf(buf, buf_len, "%s", ext4_ctime(&tm, tm_str));
       buf += len;
     } else {
       len = snprintf(buf, buf_len, EXT4_DUMMY_STR);
@@ -718,6 +745,7 @@ void ext4_show_stat_inode(struct ext4_super_block *sb, uint64_t ino, struct ext4
 {
   const char *str = NULL;
   time_t tm = 0;
+  char tm_str[EXT4_CTIME_LEN];
   int32_t len = 0;
   uint16_t mode = inode->i_mode & 0xF000;
 
@@ -916,7 +944,7 @@ void ext4_show_stat_inode(struct ext4_super_block *sb, uint64_t ino, struct ext4
   buf += len;
   if (inode->i_ctime != 0) {
     tm = (time_t)inode->i_ctime;
-    len = snprintf(buf, buf_len, "%s", ctime(&tm));
+    len = snprintf(buf, buf_len, "%s", ext4_ctime(&tm, tm_str));
     buf += len;
   } else {
     len = snprintf(buf, buf_len, "%s", EXT4_DUMMY_STR);
@@ -927,7 +955,7 @@ void ext4_show_stat_inode(struct ext4_super_block *sb, uint64_t ino, struct ext4
   buf += len;
   if (inode->i_atime != 0) {
     tm = (time_t)inode->i_atime;
-    len = snprintf(buf, buf_len, "%s", ctime(&tm));
+    len = snprintf(buf, buf_len, "%s", ext4_ctime(&tm, tm_str));
     buf += len;
   } else {
     len = snprintf(buf, buf_len, "%s", EXT4_DUMMY_STR);
@@ -938,7 +966,7 @@ void ext4_show_stat_inode(struct ext4_super_block *sb, uint64_t ino, struct ext4
   buf += len;
   if (inode->i_mtime != 0) {
     tm = (time_t)inode->i_mtime;
-    len = snprintf(buf, buf_len, "%s", ctime(&tm));
+    len = snprintf(buf, buf_len, "%s", ext4_ctime(&tm, tm_str));
     buf += len;
   } else {
     len = snprintf(buf, buf_len, "%s", EXT4_DUMMY_STR);
@@ -53,149 +53,107 @@ static char buf[EXT4_SHOW_STAT_DENTRY_SZ];
 /*
  * Function Declaration
  */
-static int32_t ext4_check_dentry(struct inode *inode, struct ext4_dir_entry_2 *dentry);
-static int32_t ext4_find_dentry(struct inode *inode, uint64_t offset, struct ext4_dir_entry_2 *dentry);
-static int32_t ext4_get_dents_num(struct inode *inode, uint64_t offset, uint32_t *dents_num);
-static int32_t ext4_get_dents(struct inode *inode, uint64_t offset, struct ext4_dir_entry_2 *dents, uint32_t *dents_index);
-static int32_t ext4_get_direct_dents_num(struct inode *inode, uint32_t *dents_num);
-static int32_t ext4_get_direct_dents(struct inode *inode, struct ext4_dir_entry_2 *dents, uint32_t *dents_index, uint32_t dents_num);
-static int32_t ext4_get_extent_dents_num(struct inode *inode, struct ext4_extent *ee, uint32_t *dents_num);
-static int32_t ext4_get_extent_dents(struct inode *inode, struct ext4_extent *ee, struct ext4_dir_entry_2 *dents, uint32_t *dents_index);
-static int32_t ext4_traverse_extent_dents_num(struct inode *inode, struct ext4_extent_idx *ei, uint32_t *dents_num);
-static int32_t ext4_traverse_extent_dents(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_dir_entry_2 *dents, uint32_t *dents_index, uint32_t dents_num);
+static uint32_t ext4_rec_len(struct inode *inode, struct ext4_dir_entry_2 *dentry);
+static int32_t ext4_check_dentry(struct inode *inode, struct ext4_dir_entry_2 *dentry, uint32_t pos);
+static int32_t ext4_find_dentry(struct inode *inode, const uint8_t *block, uint32_t pos, struct ext4_dir_entry_2 *dentry);
+static int32_t ext4_get_dents(struct inode *inode, const uint8_t *block, struct ext4_dir_entry_2 *dents, uint32_t dents_max, uint32_t *dents_num);
 
 /*
  * Function Definition
  */
-static int32_t ext4_check_dentry(struct inode *inode, struct ext4_dir_entry_2 *dentry)
+/*
+ * Length of record of dentry, with one of 64KB covering whole block of 64KB
+ */
+static uint32_t ext4_rec_len(struct inode *inode, struct ext4_dir_entry_2 *dentry)
+{
+  if (inode->i_sb->s_blocksize == (1 << 16) && (dentry->rec_len == EXT4_MAX_REC_LEN || dentry->rec_len == 0)) {
+    return 1 << 16;
+  }
+
+  return dentry->rec_len;
+}
+
+/*
+ * Check dentry at pos of block, with unused one of inode 0 valid,
+ * e.g., deleted one or fake one of htree index block
+ */
+static int32_t ext4_check_dentry(struct inode *inode, struct ext4_dir_entry_2 *dentry, uint32_t pos)
 {
   struct super_block *sb = inode->i_sb;
   struct ext4_sb_info *info = (struct ext4_sb_info *)(sb->s_fs_info);
   struct ext4_super_block *es = info->s_es;
+  uint32_t rec_len = ext4_rec_len(inode, dentry);
 
-  if (dentry->inode == EXT4_UNUSED_INO
-      || dentry->inode == EXT4_BAD_INO
-      || dentry->inode > es->s_inodes_count) {
+  if ((rec_len < EXT4_DIR_REC_LEN(1))
+    || (rec_len % 4 != 0)
+    || (rec_len < EXT4_DIR_REC_LEN(dentry->name_len))
+    || (pos + rec_len > sb->s_blocksize)
+  ) {
     return -1;
   }
 
-  if ((dentry->rec_len < EXT4_DIR_REC_LEN(1))
-    || (dentry->rec_len % 4 != 0)
-    || (dentry->rec_len < EXT4_DIR_REC_LEN(dentry->name_len))
-  ) {
-    return -1;
+  if (dentry->inode == EXT4_UNUSED_INO) {
+    return 0;
   }
 
-  if ((dentry->name_len == 0 && strlen(dentry->name) != 0)
-    || (dentry->name_len != 0 && strlen(dentry->name) == 0)) {
+  if (dentry->inode == EXT4_BAD_INO
+      || dentry->inode > es->s_inodes_count
+      || dentry->name_len == 0) {
     return -1;
   }
 
   return 0;
 }
 
-static int32_t ext4_find_dentry(struct inode *inode, uint64_t offset, struct ext4_dir_entry_2 *dentry)
+/*
+ * Get dentry at pos of block in memory, with fields before name copied first,
+ * and name copied once record of it is checked within block
+ */
+static int32_t ext4_find_dentry(struct inode *inode, const uint8_t *block, uint32_t pos, struct ext4_dir_entry_2 *dentry)
 {
-  int64_t len;
-  int32_t ret;
-
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
-
-  ret = io_read((uint8_t *)&dentry->inode, sizeof(dentry->inode));
-  if (ret != 0) {
-    return -1;
-  }
-
-  offset += sizeof(dentry->inode);
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
+  uint32_t len = (uint32_t)(sizeof(dentry->inode) + sizeof(dentry->rec_len) + sizeof(dentry->name_len) + sizeof(dentry->file_type));
 
-  ret = io_read((uint8_t *)&dentry->rec_len, sizeof(dentry->rec_len));
-  if (ret != 0) {
+  if (pos + len > inode->i_sb->s_blocksize) {
     return -1;
   }
 
-  len = (int64_t)(dentry->rec_len <= sizeof(struct ext4_dir_entry_2) ? dentry->rec_len : sizeof(struct ext4_dir_entry_2));
-  if (dentry->inode == EXT4_UNUSED_INO && len == 0) {
-    return 0;
-  }
+  memcpy((void *)dentry, (const void *)(block + pos), len);
 
-  len -= (int64_t)(sizeof(dentry->inode) + sizeof(dentry->rec_len));
-  if (len <= 0) {
+  if (ext4_check_dentry(inode, dentry, pos) != 0) {
     return -1;
   }
 
-  offset += sizeof(dentry->rec_len);
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
-
-  ret = io_read((uint8_t *)dentry + sizeof(dentry->inode) + sizeof(dentry->rec_len), len);
-  if (ret != 0) {
-    return -1;
-  }
+  memcpy((void *)dentry->name, (const void *)(block + pos + len), dentry->name_len);
 
   return 0;
 }
 
-static int32_t ext4_get_dents_num(struct inode *inode, uint64_t offset, uint32_t *dents_num)
+/*
+ * Get dentries in block of directory read in memory, by walking through records
+ * of rec_len till the end of block
+ */
+static int32_t ext4_get_dents(struct inode *inode, const uint8_t *block, struct ext4_dir_entry_2 *dents, uint32_t dents_max, uint32_t *dents_num)
 {
+  struct super_block *sb = inode->i_sb;
   struct ext4_dir_entry_2 dentry;
-  uint32_t i;
-  int32_t ret;
-
-  i = 0;
+  uint32_t pos, i;
 
-  while (1) {
+  for (pos = 0, i = 0; pos < sb->s_blocksize; pos += ext4_rec_len(inode, &dentry)) {
     memset((void *)&dentry, 0, sizeof(struct ext4_dir_entry_2));
-    ret = ext4_find_dentry(inode, offset, &dentry);
-    if (ret != 0) {
-      break;
+    if (ext4_find_dentry(inode, block, pos, &dentry) != 0) {
+      return -1;
     }
 
-    if (ext4_check_dentry(inode, &dentry) != 0) {
-      ret = 0;
-      break;
+    if (dentry.inode == EXT4_UNUSED_INO) {
+      continue;
     }
 
-    ++i;
-
-    offset += dentry.rec_len <= sizeof(struct ext4_dir_entry_2) ? dentry.rec_len : sizeof(struct ext4_dir_entry_2);
-  }
-
-  *dents_num = i;
-
-  return ret;
-}
-
-static int32_t ext4_get_dents(struct inode *inode, uint64_t offset, struct ext4_dir_entry_2 *dents, uint32_t *dents_index)
-{
-  struct ext4_dir_entry_2 dentry;
-  uint32_t i = *dents_index;
-  int32_t ret;
-
-  while (1) {
-    memset((void *)&dentry, 0, sizeof(struct ext4_dir_entry_2));
-    ret = ext4_find_dentry(inode, offset, &dentry);
-    if (ret != 0) {
-      break;
-    }
-
-    if (ext4_check_dentry(inode, &dentry) != 0) {
-      ret = 0;
-      break;
+    if (i >= dents_max) {
+      return -1;
     }
 
     dents[i++] = dentry;
 
-    offset += dentry.rec_len <= sizeof(struct ext4_dir_entry_2) ? dentry.rec_len : sizeof(struct ext4_dir_entry_2);
-
 #ifdef DEBUG_LIBEXT4_DIR
     memset((void *)buf, 0, sizeof(buf));
     ext4_show_stat_dentry(&dents[i - 1], buf, sizeof(buf));
@@ -203,281 +161,108 @@ static int32_t ext4_get_dents(struct inode *inode, uint64_t offset, struct ext4_
 #endif
   }
 
-  *dents_index = i;
-
-  return ret;
-}
-
-static int32_t ext4_get_direct_dents_num(struct inode *inode, uint32_t *dents_num)
-{
-  struct super_block *sb = inode->i_sb;
-  uint32_t num;
-  uint64_t offset;
-  int32_t i;
-  int32_t ret;
-
-  if (inode->i_block[EXT4_IND_BLOCK]
-      || inode->i_block[EXT4_DIND_BLOCK]
-      || inode->i_block[EXT4_TIND_BLOCK]) {
-    // TODO
-    return -1;
-  }
-
-  *dents_num = 0;
-
-  for (i = 0; i < EXT4_NDIR_BLOCKS; ++i) {
-    offset = (uint64_t)inode->i_block[i] * sb->s_blocksize;
-    ret = ext4_get_dents_num(inode, offset, &num);
-    if (ret != 0) {
-      break;
-    }
-
-    *dents_num += num;
-  }
-
-  return ret;
-}
-
-static int32_t ext4_get_direct_dents(struct inode *inode, struct ext4_dir_entry_2 *dents, uint32_t *dents_index, uint32_t dents_num)
-{
-  struct super_block *sb = inode->i_sb;
-  uint64_t offset;
-  int32_t i;
-  int32_t ret;
-
-  if (inode->i_block[EXT4_IND_BLOCK]
-      || inode->i_block[EXT4_DIND_BLOCK]
-      || inode->i_block[EXT4_TIND_BLOCK]) {
-    // TODO
-    return -1;
-  }
-
-  for (i = 0; i < EXT4_NDIR_BLOCKS && *dents_index < dents_num; ++i) {
-    offset = (uint64_t)inode->i_block[i] * sb->s_blocksize;
-    ret = ext4_get_dents(inode, offset, dents, dents_index);
-    if (ret != 0) {
-      break;
-    }
-  }
-
-  return ret;
-}
-
-static int32_t ext4_get_extent_dents_num(struct inode *inode, struct ext4_extent *ee, uint32_t *dents_num)
-{
-  struct super_block *sb = inode->i_sb;
-  uint64_t offset;
-
-  offset = (((uint64_t)ee->ee_start_hi << 32) | (uint64_t)ee->ee_start_lo) * sb->s_blocksize;
+  *dents_num = i;
 
-  return ext4_get_dents_num(inode, offset, dents_num);
+  return 0;
 }
 
-static int32_t ext4_get_extent_dents(struct inode *inode, struct ext4_extent *ee, struct ext4_dir_entry_2 *dents, uint32_t *dents_index)
+/*
+ * Get block of directory of inode at index of blk, mapped in place if image is mapped,
+ * or read into data of block size allocated on demand, which is reused by
+ * following calls and freed by caller, with block of NULL for hole
+ */
+int32_t ext4_raw_dir_block(struct inode *inode, uint64_t blk, uint8_t **data, const uint8_t **block)
 {
   struct super_block *sb = inode->i_sb;
-  uint64_t offset = 0;
+  int64_t offset;
+  uint64_t pblk;
 
-  offset = (((uint64_t)ee->ee_start_hi << 32) | (uint64_t)ee->ee_start_lo) * sb->s_blocksize;
+  *block = NULL;
 
-  return ext4_get_dents(inode, offset, dents, dents_index);
-}
-
-static int32_t ext4_traverse_extent_dents_num(struct inode *inode, struct ext4_extent_idx *ei, uint32_t *dents_num)
-{
-  struct ext4_extent_header eh;
-  struct ext4_extent_idx *eis = NULL;
-  struct ext4_extent *ees = NULL;
-  uint16_t nodes_num, i;
-  uint32_t num;
-  int32_t ret;
-
-  ret = ext4_ext_node_header(inode, ei, &eh);
-  if (ret != 0) {
+  if (blk * sb->s_blocksize >= (uint64_t)inode->i_size) {
     return -1;
   }
 
-  ret = ext4_ext_node_num(&eh, &nodes_num);
-  if (ret != 0) {
+  pblk = 0;
+  if (ext4_ext_map_blk(inode, blk, &pblk) != 0) {
     return -1;
   }
 
-  if (ext4_ext_node_is_leaf(&eh)) {
-    ees = (struct ext4_extent *)malloc(nodes_num * sizeof(struct ext4_extent));
-    if (!ees) {
-      return -1;
-    }
-    memset((void *)ees, 0, nodes_num * sizeof(struct ext4_extent));
-
-    ret = ext4_ext_leaf_node(inode, ei, ees, nodes_num);
-    if (ret != 0) {
-      goto ext4_traverse_extent_dents_num_exit;
-    }
-
-    for (i = 0; i < nodes_num; ++i) {
-      ret = ext4_get_extent_dents_num(inode, &ees[i], &num);
-      if (ret != 0) {
-        goto ext4_traverse_extent_dents_num_exit;
-      }
-
-      *dents_num += num;
-    }
-  } else {
-    eis = (struct ext4_extent_idx *)malloc(nodes_num * sizeof(struct ext4_extent_idx));
-    if (!eis) {
-      return -1;
-    }
-    memset((void *)eis, 0, nodes_num * sizeof(struct ext4_extent_idx));
-
-    ret = ext4_ext_index_node(inode, ei, eis, nodes_num);
-    if (ret != 0) {
-      goto ext4_traverse_extent_dents_num_exit;
-    }
-
-    for (i = 0; i < nodes_num; ++i) {
-      ret = ext4_traverse_extent_dents_num(inode, &eis[i], dents_num);
-      if (ret != 0) {
-        goto ext4_traverse_extent_dents_num_exit;
-      }
-    }
-  }
-
-  ret = 0;
-
-ext4_traverse_extent_dents_num_exit:
-
-  if (ees) {
-    free((void *)ees);
-    ees = NULL;
-  }
-
-  if (eis) {
-    free((void *)eis);
-    eis = NULL;
+  if (pblk == 0) {
+    return 0;
   }
 
-  return ret;
-}
-
-static int32_t ext4_traverse_extent_dents(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_dir_entry_2 *dents, uint32_t *dents_index, uint32_t dents_num)
-{
-  struct ext4_extent_header eh;
-  struct ext4_extent_idx *eis = NULL;
-  struct ext4_extent *ees = NULL;
-  uint16_t nodes_num, i;
-  int32_t ret;
-
-  ret = ext4_ext_node_header(inode, ei, &eh);
-  if (ret != 0) {
-    return -1;
-  }
+  offset = (int64_t)(pblk * sb->s_blocksize);
 
-  ret = ext4_ext_node_num(&eh, &nodes_num);
-  if (ret != 0) {
-    return -1;
+  *block = io_map(sb->s_io, offset, (int64_t)sb->s_blocksize);
+  if (*block) {
+    return 0;
   }
 
-  if (ext4_ext_node_is_leaf(&eh)) {
-    ees = (struct ext4_extent *)malloc(nodes_num * sizeof(struct ext4_extent));
-    if (!ees) {
-      return -1;
-    }
-    memset((void *)ees, 0, nodes_num * sizeof(struct ext4_extent));
-
-    ret = ext4_ext_leaf_node(inode, ei, ees, nodes_num);
-    if (ret != 0) {
-      goto ext4_traverse_extent_dents_exit;
-    }
-
-    for (i = 0; i < nodes_num && *dents_index < dents_num; ++i) {
-      ret = ext4_get_extent_dents(inode, &ees[i], dents, dents_index);
-      if (ret != 0) {
-        goto ext4_traverse_extent_dents_exit;
-      }
-    }
-  } else {
-    eis = (struct ext4_extent_idx *)malloc(nodes_num * sizeof(struct ext4_extent_idx));
-    if (!eis) {
+  if (!*data) {
+    *data = (uint8_t *)malloc(sb->s_blocksize);
+    if (!*data) {
       return -1;
     }
-    memset((void *)eis, 0, nodes_num * sizeof(struct ext4_extent_idx));
-
-    ret = ext4_ext_index_node(inode, ei, eis, nodes_num);
-    if (ret != 0) {
-      goto ext4_traverse_extent_dents_exit;
-    }
-
-    for (i = 0; i < nodes_num && *dents_index < dents_num; ++i) {
-      ret = ext4_traverse_extent_dents(inode, &eis[i], dents, dents_index, dents_num);
-      if (ret != 0) {
-        goto ext4_traverse_extent_dents_exit;
-      }
-    }
   }
 
-  ret = 0;
-
-ext4_traverse_extent_dents_exit:
-
-  if (ees) {
-    free((void *)ees);
-    ees = NULL;
+  if (io_pread(sb->s_io, offset, *data, (int64_t)sb->s_blocksize) != (int64_t)sb->s_blocksize) {
+    return -1;
   }
 
-  if (eis) {
-    free((void *)eis);
-    eis = NULL;
-  }
+  *block = (const uint8_t *)*data;
 
-  return ret;
+  return 0;
 }
 
-int32_t ext4_raw_dentry_num(struct dentry *parent, uint32_t *childs_num)
+/*
+ * Get child dentries in block of directory of inode at index of blk, without hash tree,
+ * as blocks of htree index hold fake dentries of inode 0 only
+ */
+int32_t ext4_raw_dentry_block(struct inode *inode, uint64_t blk, struct ext4_dir_entry_2 *childs, uint32_t childs_max, uint32_t *childs_num)
 {
-  struct inode *inode = parent->d_inode;
+  const uint8_t *block = NULL;
+  uint8_t *data = NULL;
   int32_t ret;
 
+  *childs_num = 0;
+
   /*
-   * Support for linear directories only
-   * and hash tree directories are NOT supported yet
+   * Read block once, and parse it in memory
    */
-  if (is_dx(inode)) {
-    return -1;
+  ret = ext4_raw_dir_block(inode, blk, &data, &block);
+  if (ret == 0 && block) {
+    ret = ext4_get_dents(inode, block, childs, childs_max, childs_num);
   }
 
-  *childs_num = 0;
-
-  if (ext4_ext_header_check(inode) == 0) {
-    ret = ext4_traverse_extent_dents_num(inode, NULL, childs_num);
-  } else {
-    ret = ext4_get_direct_dents_num(inode, childs_num);
+  if (data) {
+    free((void *)data);
+    data = NULL;
   }
 
   return ret;
 }
 
-int32_t ext4_raw_dentry(struct dentry *parent, struct ext4_dir_entry_2 *childs, uint32_t childs_num)
+/*
+ * Find dentry matched with name in block of directory read in memory,
+ * return 1 if not found
+ */
+int32_t ext4_find_dentry_block(struct inode *inode, const uint8_t *block, const char *name, uint32_t len, struct ext4_dir_entry_2 *dentry)
 {
-  struct inode *inode = parent->d_inode;
-  uint32_t childs_index;
-  int32_t ret;
-
-  /*
-   * Support for linear directories only
-   * and hash tree directories are NOT supported yet
-   */
-  if (is_dx(inode)) {
-    return -1;
-  }
+  struct super_block *sb = inode->i_sb;
+  uint32_t pos;
 
-  parent->d_childnum = childs_num;
-  childs_index = 0;
+  for (pos = 0; pos < sb->s_blocksize; pos += ext4_rec_len(inode, dentry)) {
+    memset((void *)dentry, 0, sizeof(struct ext4_dir_entry_2));
+    if (ext4_find_dentry(inode, block, pos, dentry) != 0) {
+      return -1;
+    }
 
-  if (ext4_ext_header_check(inode) == 0) {
-    ret = ext4_traverse_extent_dents(inode, NULL, childs, &childs_index, childs_num);
-  } else {
-    ret = ext4_get_direct_dents(inode, childs, &childs_index, childs_num);
+    if (dentry->inode != EXT4_UNUSED_INO && dentry->name_len == len
+        && !memcmp((const void *)dentry->name, (const void *)name, len)) {
+      return 0;
+    }
   }
 
-  return ret;
+  return 1;
 }
@@ -38,6 +38,10 @@
 /*
  * Macro Definition
  */
+/*
+ * Max depth of extent tree, refer to 'EXT4_MAX_EXTENT_DEPTH' in kernel/fs/ext4/ext4_extents.h
+ */
+#define EXT4_EXT_DEPTH_MAX  (5)
 
 /*
  * Type Definition
@@ -53,6 +57,7 @@ static char buf[EXT4_SHOW_STAT_EXTENT_SZ];
 /*
  * Function Declaration
  */
+static int32_t ext4_ext_map_node(struct inode *inode, struct ext4_extent_idx *ei, int32_t depth, struct extent_status **es, uint32_t *es_num, uint32_t *es_max);
 
 /*
  * Function Definition
@@ -70,34 +75,65 @@ int32_t ext4_ext_header_check(struct inode *inode)
   return 0;
 }
 
-int32_t ext4_ext_node_header(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_extent_header *eh)
+/*
+ * Get node of extent tree, i.e., root in inode, or block of ei mapped in place
+ * or read into blk of block size, with length of it in node_len
+ */
+const uint8_t* ext4_ext_node_block(struct inode *inode, struct ext4_extent_idx *ei, uint8_t *blk, uint32_t *node_len)
 {
   struct super_block *sb = inode->i_sb;
+  const uint8_t *node = NULL;
   int64_t offset;
-  int32_t ret = 0;
 
   if (!ei) {
-    memcpy((void *)eh, (const void *)inode->i_block, sizeof(struct ext4_extent_header));
-  } else {
-    offset = (((uint64_t)ei->ei_leaf_hi << 32) | (uint64_t)ei->ei_leaf_lo) * sb->s_blocksize;
+    *node_len = (uint32_t)(EXT4_N_BLOCKS * sizeof(uint32_t));
+    return (const uint8_t *)inode->i_block;
+  }
 
-    ret = io_seek(offset);
-    if (ret != 0) {
-      return -1;
-    }
+  *node_len = (uint32_t)sb->s_blocksize;
+  offset = (int64_t)((((uint64_t)ei->ei_leaf_hi << 32) | (uint64_t)ei->ei_leaf_lo) * sb->s_blocksize);
 
-    ret = io_read((uint8_t *)eh, sizeof(struct ext4_extent_header));
-    if (ret != 0) {
-      return -1;
-    }
+  /*
+   * Parse node in place if image is mapped
+   */
+  node = io_map(sb->s_io, offset, (int64_t)*node_len);
+  if (node) {
+    return node;
   }
 
+  if (io_pread(sb->s_io, offset, blk, (int64_t)*node_len) != (int64_t)*node_len) {
+    return NULL;
+  }
+
+  return (const uint8_t *)blk;
+}
+
+/*
+ * Get header of node, and check it against length of node and depth expected,
+ * or max depth of tree if depth is negative, i.e., of root
+ */
+int32_t ext4_ext_node_header(const uint8_t *node, uint32_t node_len, int32_t depth, struct ext4_extent_header *eh)
+{
+  memcpy((void *)eh, (const void *)node, sizeof(struct ext4_extent_header));
+
 #ifdef DEBUG_LIBEXT4_EXTENT
   memset((void *)buf, 0, sizeof(buf));
   ext4_show_stat_extent_header(eh, buf, sizeof(buf));
   fprintf(stdout, "%s", buf);
 #endif
 
+  if (eh->eh_magic != EXT4_EXT_MAGIC || eh->eh_entries > eh->eh_max) {
+    return -1;
+  }
+
+  if (sizeof(struct ext4_extent_header) + (uint32_t)eh->eh_max * sizeof(struct ext4_extent) > node_len) {
+    return -1;
+  }
+
+  if (depth < 0 ? eh->eh_depth > EXT4_EXT_DEPTH_MAX : eh->eh_depth != (uint16_t)depth) {
+    return -1;
+  }
+
   return 0;
 }
 
@@ -113,98 +149,280 @@ int32_t ext4_ext_node_num(struct ext4_extent_header *eh, uint16_t *nodes_num)
   return 0;
 }
 
-int32_t ext4_ext_index_node(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_extent_idx *nodes, uint16_t nodes_num)
+/*
+ * Parse index entries following header of node
+ */
+int32_t ext4_ext_index_node(const uint8_t *node, struct ext4_extent_idx *nodes, uint16_t nodes_num)
 {
-  struct super_block *sb = inode->i_sb;
-  uint8_t *ptr = NULL;
-  int64_t offset;
+  const uint8_t *ptr = node + sizeof(struct ext4_extent_header);
   uint16_t i;
-  int32_t ret = 0;
 
-  if (!ei) {
-    ptr = (uint8_t *)((uint8_t *)(inode->i_block) + sizeof(struct ext4_extent_header));
+  for (i = 0; i < nodes_num; ++i) {
+    memcpy((void *)&nodes[i], (const void *)ptr, sizeof(struct ext4_extent_idx));
+    ptr += sizeof(struct ext4_extent_idx);
+
+#ifdef DEBUG_LIBEXT4_EXTENT
+    memset((void *)buf, 0, sizeof(buf));
+    ext4_show_stat_extent_idx(&nodes[i], buf, sizeof(buf));
+    fprintf(stdout, "%s", buf);
+#endif
+  }
+
+  return 0;
+}
+
+/*
+ * Parse extent entries following header of node
+ */
+int32_t ext4_ext_leaf_node(const uint8_t *node, struct ext4_extent *nodes, uint16_t nodes_num)
+{
+  const uint8_t *ptr = node + sizeof(struct ext4_extent_header);
+  uint16_t i;
+
+  for (i = 0; i < nodes_num; ++i) {
+    memcpy((void *)&nodes[i], (const void *)ptr, sizeof(struct ext4_extent));
+    ptr += sizeof(struct ext4_extent);
+
+#ifdef DEBUG_LIBEXT4_EXTENT
+    memset((void *)buf, 0, sizeof(buf));
+    ext4_show_stat_extent(&nodes[i], buf, sizeof(buf));
+    fprintf(stdout, "%s", buf);
+#endif
+  }
 
-    for (i = 0; i < nodes_num; ++i) {
-      memcpy((void *)&nodes[i], (const void *)ptr, sizeof(struct ext4_extent_idx));
-      ptr += sizeof(struct ext4_extent_idx);
+  return 0;
+}
+
+/*
+ * Append extents of node of extent tree to map, and descend into index nodes,
+ * with node read as a whole block once, and depth of it checked as expected
+ */
+static int32_t ext4_ext_map_node(struct inode *inode, struct ext4_extent_idx *ei, int32_t depth, struct extent_status **es, uint32_t *es_num, uint32_t *es_max)
+{
+  struct ext4_extent_header eh;
+  struct ext4_extent_idx *eis = NULL;
+  struct ext4_extent *ees = NULL;
+  struct extent_status *ptr = NULL, *prev = NULL;
+  const uint8_t *node = NULL;
+  uint8_t *blk = NULL;
+  uint32_t node_len, len, max;
+  uint16_t num, i;
+  int32_t ret;
+
+  if (ei) {
+    blk = (uint8_t *)malloc(inode->i_sb->s_blocksize);
+    if (!blk) {
+      return -1;
     }
-  } else {
-    offset = (((uint64_t)ei->ei_leaf_hi << 32) | (uint64_t)ei->ei_leaf_lo) * sb->s_blocksize + sizeof(struct ext4_extent_header);
+  }
+
+  ret = -1;
+
+  node = ext4_ext_node_block(inode, ei, blk, &node_len);
+  if (!node) {
+    goto ext4_ext_map_node_exit;
+  }
+
+  if (ext4_ext_node_header(node, node_len, depth, &eh) != 0) {
+    goto ext4_ext_map_node_exit;
+  }
+
+  if (ext4_ext_node_num(&eh, &num) != 0) {
+    goto ext4_ext_map_node_exit;
+  }
+
+  if (num == 0) {
+    ret = 0;
+    goto ext4_ext_map_node_exit;
+  }
 
-    ret = io_seek(offset);
+  if (ext4_ext_node_is_leaf(&eh)) {
+    ees = (struct ext4_extent *)malloc(num * sizeof(struct ext4_extent));
+    if (!ees) {
+      goto ext4_ext_map_node_exit;
+    }
+    memset((void *)ees, 0, num * sizeof(struct ext4_extent));
+
+    ret = ext4_ext_leaf_node(node, ees, num);
     if (ret != 0) {
-      return -1;
+      goto ext4_ext_map_node_exit;
     }
 
-    for (i = 0; i < nodes_num; ++i) {
-      ret = io_read((uint8_t *)&nodes[i], sizeof(struct ext4_extent_idx));
-      if (ret != 0) {
-        break;
+    for (i = 0; i < num; ++i) {
+      len = (uint32_t)ees[i].ee_len;
+      if (len > EXT_INIT_MAX_LEN) {
+        len -= EXT_INIT_MAX_LEN;
+      }
+
+      if (len == 0) {
+        continue;
+      }
+
+      /*
+       * Refuse extents out of order or overlapped, as map is binary searched
+       */
+      prev = *es_num > 0 ? &(*es)[*es_num - 1] : NULL;
+      if (prev && (uint64_t)ees[i].ee_block < (uint64_t)prev->es_lblk + prev->es_len) {
+        ret = -1;
+        goto ext4_ext_map_node_exit;
+      }
+
+      if (*es_num == *es_max) {
+        max = *es_max ? *es_max << 1 : EXT4_N_BLOCKS;
+        ptr = (struct extent_status *)realloc((void *)*es, max * sizeof(struct extent_status));
+        if (!ptr) {
+          ret = -1;
+          goto ext4_ext_map_node_exit;
+        }
+
+        *es = ptr;
+        *es_max = max;
       }
 
-      offset += sizeof(struct ext4_extent_idx);
-      ret = io_seek(offset);
+      ptr = &(*es)[*es_num];
+      ptr->es_lblk = (uint32_t)ees[i].ee_block;
+      ptr->es_len = len;
+      ptr->es_pblk = ((uint64_t)ees[i].ee_start_hi << 32) | (uint64_t)ees[i].ee_start_lo;
+      ptr->es_unwritten = ees[i].ee_len > EXT_INIT_MAX_LEN ? 1 : 0;
+      *es_num += 1;
+    }
+  } else {
+    eis = (struct ext4_extent_idx *)malloc(num * sizeof(struct ext4_extent_idx));
+    if (!eis) {
+      goto ext4_ext_map_node_exit;
+    }
+    memset((void *)eis, 0, num * sizeof(struct ext4_extent_idx));
+
+    ret = ext4_ext_index_node(node, eis, num);
+    if (ret != 0) {
+      goto ext4_ext_map_node_exit;
+    }
+
+    /*
+     * Release block of node before descending, as entries of it are parsed already
+     */
+    if (blk) {
+      free((void *)blk);
+      blk = NULL;
+    }
+
+    for (i = 0; i < num; ++i) {
+      ret = ext4_ext_map_node(inode, &eis[i], (int32_t)eh.eh_depth - 1, es, es_num, es_max);
       if (ret != 0) {
-        break;
+        goto ext4_ext_map_node_exit;
       }
     }
   }
 
-#ifdef DEBUG_LIBEXT4_EXTENT
-  for (i = 0; i < nodes_num; ++i) {
-    memset((void *)buf, 0, sizeof(buf));
-    ext4_show_stat_extent_idx(&nodes[i], buf, sizeof(buf));
-    fprintf(stdout, "%s", buf);
+  ret = 0;
+
+ ext4_ext_map_node_exit:
+
+  if (ees) {
+    free((void *)ees);
+    ees = NULL;
+  }
+
+  if (eis) {
+    free((void *)eis);
+    eis = NULL;
+  }
+
+  if (blk) {
+    free((void *)blk);
+    blk = NULL;
   }
-#endif
 
   return ret;
 }
 
-int32_t ext4_ext_leaf_node(struct inode *inode, struct ext4_extent_idx *ei, struct ext4_extent *nodes, uint16_t nodes_num)
+/*
+ * Flatten extent tree of inode into map of extents sorted by logical block,
+ * with length of unwritten extents in es_len, and map freed by caller
+ */
+int32_t ext4_ext_map(struct inode *inode, struct extent_status **es, uint32_t *es_num)
 {
-  struct super_block *sb = inode->i_sb;
-  uint8_t *ptr = NULL;
-  int64_t offset;
-  uint16_t i;
-  int32_t ret = 0;
+  struct extent_status *ptr = NULL;
+  uint32_t es_max = 0;
 
-  if (!ei) {
-    ptr = (uint8_t *)((uint8_t *)(inode->i_block) + sizeof(struct ext4_extent_header));
+  *es = NULL;
+  *es_num = 0;
+
+  if (ext4_ext_header_check(inode) != 0) {
+    return -1;
+  }
 
-    for (i = 0; i < nodes_num; ++i) {
-      memcpy((void *)&nodes[i], (const void *)ptr, sizeof(struct ext4_extent));
-      ptr += sizeof(struct ext4_extent);
+  if (ext4_ext_map_node(inode, NULL, -1, es, es_num, &es_max) != 0) {
+    if (*es) {
+      free((void *)*es);
+      *es = NULL;
     }
-  } else {
-    offset = (((uint64_t)ei->ei_leaf_hi << 32) | (uint64_t)ei->ei_leaf_lo) * sb->s_blocksize + sizeof(struct ext4_extent_header);
+    *es_num = 0;
+    return -1;
+  }
 
-    ret = io_seek(offset);
-    if (ret != 0) {
-      return -1;
+  /*
+   * Trim map to extents in it, as it is kept along with inode
+   */
+  if (*es_num > 0 && *es_num < es_max) {
+    ptr = (struct extent_status *)realloc((void *)*es, *es_num * sizeof(struct extent_status));
+    if (ptr) {
+      *es = ptr;
     }
+  }
 
-    for (i = 0; i < nodes_num; ++i) {
-      ret = io_read((uint8_t *)&nodes[i], sizeof(struct ext4_extent));
-      if (ret != 0) {
-        break;
-      }
+  return 0;
+}
 
-      offset += sizeof(struct ext4_extent);
-      ret = io_seek(offset);
-      if (ret != 0) {
-        break;
-      }
+/*
+ * Get index of the first extent starting after lblk by binary search,
+ * so that the one before it may hold lblk
+ */
+uint32_t ext4_ext_map_find(const struct extent_status *es, uint32_t es_num, uint64_t lblk)
+{
+  uint32_t lo = 0, hi = es_num, mid;
+
+  while (lo < hi) {
+    mid = lo + ((hi - lo) >> 1);
+
+    if ((uint64_t)es[mid].es_lblk <= lblk) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
   }
 
-#ifdef DEBUG_LIBEXT4_EXTENT
-  for (i = 0; i < nodes_num; ++i) {
-    memset((void *)buf, 0, sizeof(buf));
-    ext4_show_stat_extent(&nodes[i], buf, sizeof(buf));
-    fprintf(stdout, "%s", buf);
+  return lo;
+}
+
+/*
+ * Map logical block of inode to physical one, by extents mapped on inode,
+ * or ones of extent tree or indirect blocks read now if not mapped yet,
+ * with physical block of 0 for hole or unwritten extent
+ */
+int32_t ext4_ext_map_blk(struct inode *inode, uint64_t lblk, uint64_t *pblk)
+{
+  struct extent_status *es = NULL;
+  uint32_t es_num, i;
+
+  if (inode->i_mapped) {
+    es = inode->i_es;
+    es_num = inode->i_es_num;
+  } else if (ext4_map_blocks(inode, &es, &es_num) != 0) {
+    return -1;
   }
-#endif
 
-  return ret;
+  *pblk = 0;
+
+  i = ext4_ext_map_find(es, es_num, lblk);
+  if (i > 0 && lblk < (uint64_t)es[i - 1].es_lblk + es[i - 1].es_len && !es[i - 1].es_unwritten) {
+    *pblk = es[i - 1].es_pblk + lblk - es[i - 1].es_lblk;
+  }
+
+  if (!inode->i_mapped && es) {
+    free((void *)es);
+    es = NULL;
+  }
+
+  return 0;
 }
@@ -38,6 +38,10 @@
 /*
  * Macro Definition
  */
+/*
+ * Max number of read requests issued in one batch
+ */
+#define EXT4_FILE_REQS_NUM  (32)
 
 /*
  * Type Definition
@@ -50,277 +54,179 @@
 /*
  * Function Declaration
  */
-static int32_t ext4_get_file(struct inode *inode, int64_t pos, uint64_t offset, char *buf, int64_t buf_len, int64_t *read_len);
-static int32_t ext4_get_extent_file(struct inode *inode, struct ext4_extent *ee, int64_t pos, char *buf, int64_t buf_len, int64_t *read_len);
-static int32_t ext4_get_extent_blk_pos(struct inode *inode, struct ext4_extent *ees, uint16_t num, int64_t offset, uint16_t *index, int64_t *pos);
-static int32_t ext4_traverse_extent_file(struct inode *inode, struct ext4_extent_idx *ei, int64_t offset, char *buf, int64_t buf_len, int64_t *read_len);
-static int32_t ext4_get_direct_link(struct inode *inode, uint64_t index, int64_t pos, char *buf, int64_t buf_len, int64_t *read_len);
+static int32_t ext4_read_reqs(struct inode *inode, struct io_req *reqs, uint32_t reqs_num, const char *buf, int64_t *read_len);
+static int32_t ext4_read_extent_file(struct inode *inode, const struct extent_status *es, uint32_t es_num, int64_t offset, char *buf, int64_t buf_len, int64_t *read_len);
 
 /*
  * Function Definition
  */
-static int32_t ext4_get_file(struct inode *inode, int64_t pos, uint64_t offset, char *buf, int64_t buf_len, int64_t *read_len)
+/*
+ * Issue read requests in one batch
+ * return 1 if any of them is short, with length read from buf up to it
+ */
+static int32_t ext4_read_reqs(struct inode *inode, struct io_req *reqs, uint32_t reqs_num, const char *buf, int64_t *read_len)
 {
-  int64_t len;
-  int32_t ret;
+  uint32_t i;
 
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
+  if (reqs_num == 0) {
+    return 0;
   }
 
-#if 0 //DISUSED here
-  len = (int64_t)(ee->ee_len * sb->s_blocksize) - pos;
-#else
-  len = inode->i_size - pos;
-#endif
-
-  len = len > (int64_t)buf_len ? (int64_t)buf_len : len;
-
-  ret = io_read((uint8_t *)buf, len);
-  if (ret != 0) {
+  if (io_pread_batch(inode->i_sb->s_io, reqs, reqs_num) != 0) {
     return -1;
   }
 
-  *read_len = len;
-
-  return 0;
-}
-
-static int32_t ext4_get_extent_file(struct inode *inode, struct ext4_extent *ee, int64_t pos, char *buf, int64_t buf_len, int64_t *read_len)
-{
-  struct super_block *sb = inode->i_sb;
-  uint64_t offset;
-
-  offset = (((uint64_t)ee->ee_start_hi << 32) | (uint64_t)ee->ee_start_lo) * sb->s_blocksize + pos;
-
-  return ext4_get_file(inode, pos, offset, buf, buf_len, read_len);
-}
-
-static int32_t ext4_get_extent_blk_pos(struct inode *inode, struct ext4_extent *ees, uint16_t num, int64_t offset, uint16_t *index, int64_t *pos)
-{
-  struct super_block *sb = inode->i_sb;
-  int64_t size, len;
-  uint16_t i;
-
-  for (i = 0, size = 0; i < num; ++i) {
-    size += (int64_t)(ees[i].ee_len * sb->s_blocksize);
-    len = size - offset;
-
-    if (len >= 0) {
-      if (len == 0) {
-        *index = i + 1;
-        *pos = 0;
-      } else {
-        *index = i;
-        *pos = (int64_t)(ees[i].ee_len * sb->s_blocksize) - len;
-      }
-
-      break;
+  for (i = 0; i < reqs_num; ++i) {
+    if (reqs[i].ret != reqs[i].len) {
+      *read_len = (int64_t)((const char *)reqs[i].data - buf) + (reqs[i].ret > 0 ? reqs[i].ret : 0);
+      return 1;
     }
   }
 
-  if (*index >= num) {
-    return -1;
-  }
-
   return 0;
 }
 
-static int32_t ext4_traverse_extent_file(struct inode *inode, struct ext4_extent_idx *ei, int64_t offset, char *buf, int64_t buf_len, int64_t *read_len)
+/*
+ * Read file at offset by extents sorted by logical block,
+ * with the first extent found by binary search, and holes and
+ * unwritten extents read as zeros, up to length of buffer and size of file
+ */
+static int32_t ext4_read_extent_file(struct inode *inode, const struct extent_status *es, uint32_t es_num, int64_t offset, char *buf, int64_t buf_len, int64_t *read_len)
 {
-  struct ext4_extent_header eh;
-  struct ext4_extent_idx *eis = NULL;
-  struct ext4_extent *ees = NULL;
-  char *ptr = buf;
-  uint16_t num, index = 0, i;
-  int64_t pos = 0, curr_len, ret_len, min_len;
+  struct io_req reqs[EXT4_FILE_REQS_NUM];
+  int64_t blksz = (int64_t)inode->i_sb->s_blocksize;
+  int64_t pos, left, start, end, len;
+  uint32_t i, reqs_num;
   int32_t ret;
 
-  curr_len = (int64_t)buf_len;
-  min_len = inode->i_size > (int64_t)buf_len ? (int64_t)buf_len : inode->i_size;
   *read_len = 0;
 
-  ret = ext4_ext_node_header(inode, ei, &eh);
-  if (ret != 0) {
-    return -1;
+  if (offset >= inode->i_size) {
+    return 0;
   }
 
-  ret = ext4_ext_node_num(&eh, &num);
-  if (ret != 0) {
-    return -1;
+  left = buf_len > inode->i_size - offset ? inode->i_size - offset : buf_len;
+
+  /*
+   * Start at extent holding offset, or the one following hole of it
+   */
+  i = ext4_ext_map_find(es, es_num, (uint64_t)(offset / blksz));
+  if (i > 0 && offset < ((int64_t)es[i - 1].es_lblk + (int64_t)es[i - 1].es_len) * blksz) {
+    i -= 1;
   }
 
-  if (ext4_ext_node_is_leaf(&eh)) {
-    ees = (struct ext4_extent *)malloc(num * sizeof(struct ext4_extent));
-    if (!ees) {
-      return -1;
-    }
-    memset((void *)ees, 0, num * sizeof(struct ext4_extent));
+  for (pos = offset, reqs_num = 0; left > 0; pos += len, left -= len) {
+    start = i < es_num ? (int64_t)es[i].es_lblk * blksz : INT64_MAX;
 
-    ret = ext4_ext_leaf_node(inode, ei, ees, num);
-    if (ret != 0) {
-      goto ext4_traverse_extent_file_exit;
+    if (pos < start) {
+      len = start - pos > left ? left : start - pos;
+      memset((void *)(buf + (pos - offset)), 0, (size_t)len);
+      continue;
     }
 
-    ret = ext4_get_extent_blk_pos(inode, ees, num, offset, &index, &pos);
-    if (ret != 0) {
-      goto ext4_traverse_extent_file_exit;
-    }
+    end = ((int64_t)es[i].es_lblk + (int64_t)es[i].es_len) * blksz;
+    len = end - pos > left ? left : end - pos;
 
-    for (i = index; i < num; ++i) {
-      if (i == index) {
-        ret = ext4_get_extent_file(inode, &ees[i], pos, ptr, curr_len, &ret_len);
-      } else {
-        ret = ext4_get_extent_file(inode, &ees[i], 0, ptr, curr_len, &ret_len);
-      }
+    if (es[i].es_unwritten) {
+      memset((void *)(buf + (pos - offset)), 0, (size_t)len);
+    } else {
+      reqs[reqs_num].offset = (int64_t)es[i].es_pblk * blksz + (pos - start);
+      reqs[reqs_num].data = (uint8_t *)(buf + (pos - offset));
+      reqs[reqs_num].len = len;
+      reqs[reqs_num].ret = 0;
 
-      if (ret != 0) {
-        goto ext4_traverse_extent_file_exit;
-      }
+      if (++reqs_num == EXT4_FILE_REQS_NUM) {
+        ret = ext4_read_reqs(inode, reqs, reqs_num, buf, read_len);
+        if (ret != 0) {
+          return ret < 0 ? -1 : 0;
+        }
 
-      *read_len += ret_len;
-      if (*read_len >= min_len) {
-        *read_len = min_len;
-        break;
+        reqs_num = 0;
       }
-
-      ptr += ret_len;
-      curr_len -= ret_len;
-    }
-  } else {
-    eis = (struct ext4_extent_idx *)malloc(num * sizeof(struct ext4_extent_idx));
-    if (!eis) {
-      return -1;
     }
-    memset((void *)eis, 0, num * sizeof(struct ext4_extent_idx));
 
-    ret = ext4_ext_index_node(inode, ei, eis, num);
-    if (ret != 0) {
-      goto ext4_traverse_extent_file_exit;
-    }
-
-    for (i = 0; i < num; ++i) {
-      ret = ext4_traverse_extent_file(inode, &eis[i], offset, ptr, curr_len, &ret_len);
-      if (ret != 0) {
-        goto ext4_traverse_extent_file_exit;
-      }
-
-      *read_len += ret_len;
-      if (*read_len >= min_len) {
-        *read_len = min_len;
-        break;
-      }
-
-      ptr += ret_len;
-      curr_len -= ret_len;
+    if (pos + len >= end) {
+      i += 1;
     }
   }
 
-  ret = 0;
-
-ext4_traverse_extent_file_exit:
-
-  if (ees) {
-    free((void *)ees);
-    ees = NULL;
+  ret = ext4_read_reqs(inode, reqs, reqs_num, buf, read_len);
+  if (ret != 0) {
+    return ret < 0 ? -1 : 0;
   }
 
-  if (eis) {
-    free((void *)eis);
-    eis = NULL;
-  }
+  *read_len = pos - offset;
 
-  return ret;
+  return 0;
 }
 
-static int32_t ext4_get_direct_link(struct inode *inode, uint64_t index, int64_t pos, char *buf, int64_t buf_len, int64_t *read_len)
+/*
+ * Read file at offset by extents mapped on inode, or ones of extent tree
+ * or runs of indirect blocks read now if not mapped yet
+ */
+int32_t ext4_raw_file(struct inode *inode, int64_t offset, char *buf, size_t buf_len, int64_t *read_len)
 {
-  struct super_block *sb = inode->i_sb;
-  uint64_t offset;
-  int64_t len;
+  struct extent_status *es = NULL;
+  uint32_t es_num;
   int32_t ret;
 
-  offset = inode->i_block[index] * sb->s_blocksize + pos;
-  ret = io_seek(offset);
-  if (ret != 0) {
+  if (inode->i_flags & EXT4_INLINE_DATA_FL) {
     return -1;
   }
 
-  len = (int64_t)sb->s_blocksize - pos;
-  len = len > (int64_t)buf_len ? (int64_t)buf_len : len;
+  if (inode->i_mapped) {
+    return ext4_read_extent_file(inode, inode->i_es, inode->i_es_num, offset, buf, (int64_t)buf_len, read_len);
+  }
 
-  ret = io_read((uint8_t *)buf, len);
-  if (ret != 0) {
+  if (ext4_map_blocks(inode, &es, &es_num) != 0) {
     return -1;
   }
 
-  *read_len = len;
+  ret = ext4_read_extent_file(inode, es, es_num, offset, buf, (int64_t)buf_len, read_len);
 
-  return 0;
-}
+  if (es) {
+    free((void *)es);
+    es = NULL;
+  }
 
-int32_t ext4_raw_file(struct inode *inode, int64_t offset, char *buf, size_t buf_len, int64_t *read_len)
-{
-  return ext4_traverse_extent_file(inode, NULL, offset, buf, buf_len, read_len);
+  return ret;
 }
 
 int32_t ext4_raw_link(struct inode *inode, int64_t offset, char *buf, size_t buf_len, int64_t *read_len)
 {
-  struct super_block *sb = inode->i_sb;
-  char *ptr = buf;
-  int64_t pos, link_len, min_len, curr_len, ret_len;
-  uint64_t i, index;
-  int32_t ret;
+  int64_t link_len, curr_len;
 
-  index = (uint64_t)offset / sb->s_blocksize;
-  pos = offset % (int64_t)sb->s_blocksize;
   link_len = inode->i_size + 1;
-  min_len = link_len > (int64_t)buf_len ? (int64_t)buf_len : link_len;
   *read_len = 0;
 
   if (link_len <= (EXT4_N_BLOCKS * sizeof(uint32_t))) {
-    curr_len = min_len - offset;
+    /*
+     * Read fast symlink in i_block from offset in bytes, with null terminating it
+     */
+    curr_len = link_len - offset;
+    if (curr_len < 0) {
+      return -1;
+    }
 
+    curr_len = curr_len > (int64_t)buf_len ? (int64_t)buf_len : curr_len;
     if (curr_len > 0) {
-      memcpy((void *)buf, inode->i_block + offset, (size_t)curr_len);
-      *read_len = curr_len;
-    } else if (curr_len == 0) {
-      *read_len = 0;
-    } else {
-      return -1;
+      memcpy((void *)buf, (const char *)inode->i_block + offset, (size_t)curr_len);
     }
+
+    *read_len = curr_len;
   } else {
     /*
-     * Refer to 'EXT4_NDIR_BLOCKS'/'EXT4_IND_BLOCK'/'EXT4_DIND_BLOCK'/'EXT4_TIND_BLOCK'
+     * Read slow symlink as file, by extents or indirect blocks,
+     * with null terminating it following, as for fast symlink
      */
-    curr_len = (int64_t)buf_len;
-
-    if (link_len <= (EXT4_NDIR_BLOCKS * (int64_t)sb->s_blocksize)) {
-      for (i = index; i < EXT4_NDIR_BLOCKS; ++i) {
-        if (i == index) {
-          ret = ext4_get_direct_link(inode, i, pos, ptr, curr_len, &ret_len);
-        } else {
-          ret = ext4_get_direct_link(inode, i, 0, ptr, curr_len, &ret_len);
-        }
-
-        if (ret != 0) {
-          return -1;
-        }
-
-        *read_len += ret_len;
-        if (*read_len >= min_len) {
-          *read_len = min_len;
-          break;
-        }
-
-        ptr += ret_len;
-        curr_len -= ret_len;
-      }
-    } else {
-      // TODO
+    if (ext4_raw_file(inode, offset, buf, buf_len, read_len) != 0) {
       return -1;
     }
+
+    if (*read_len < (int64_t)buf_len && offset + *read_len == inode->i_size) {
+      buf[*read_len] = '\0';
+      *read_len += 1;
+    }
   }
 
   return 0;
@@ -35,6 +35,7 @@
 
 #include "include/base/debug.h"
 #include "include/base/types.h"
+#include "include/base/lock.h"
 #include "include/libio/io.h"
 #include "include/fs.h"
 #include "include/libext4/libext4.h"
@@ -44,6 +45,24 @@
  */
 #define init_name_hash() 0
 
+/*
+ * Min number of slots of hash table of inodes,
+ * which is grown to keep load factor no more than 1/2
+ */
+#define FS_INODES_NUM_MIN  (1024)
+
+/*
+ * Min number of buckets of hash table of dentries,
+ * which is grown to keep load factor no more than 1
+ */
+#define FS_DENTRIES_NUM_MIN  (1024)
+
+/*
+ * Max length of name following dentry in slab,
+ * and longer one is allocated from slab of names
+ */
+#define FS_DNAME_INLINE_LEN  (32)
+
 /*
  * Type Definition
  */
@@ -51,11 +70,12 @@
 /*
  * Global Variable Definition
  */
-static struct file_system_type fs_file_type;
-static struct super_block fs_sb;
-
-static char fs_stat_sb[EXT4_SHOW_STAT_SB_SZ];
-static char fs_stat_inode[EXT4_SHOW_STAT_INODE_SZ];
+/*
+ * Buffers of raw stats returned, one per thread
+ * so that mounts are shown by threads at the same time
+ */
+static THREAD_LOCAL char fs_stat_sb[EXT4_SHOW_STAT_SB_SZ];
+static THREAD_LOCAL char fs_stat_inode[EXT4_SHOW_STAT_INODE_SZ];
 
 /*
  * Function Declaration
@@ -65,25 +85,49 @@ static inline uint64_t partial_name_hash(uint64_t c, uint64_t prevhash);
 static inline uint64_t end_name_hash(uint64_t hash);
 static uint64_t fs_name_hash(const unsigned char *name, uint32_t len);
 
+static inline bool fs_is_dots(const unsigned char *name, uint8_t name_len);
 static struct dentry* fs_alloc_dentry(struct super_block *sb);
 static struct dentry* fs_alloc_dentry_child(struct dentry *parent);
 static void fs_d_release(struct dentry *dentry);
 static struct dentry* fs_instantiate_dentry(struct dentry *dentry, struct inode *inode, const unsigned char *name, uint8_t name_len);
+static inline bool fs_is_populated(struct dentry *dentry);
+static void fs_lru_populate(struct dentry *dentry);
+static void fs_lru_depopulate(struct dentry *dentry);
+static uint32_t fs_evict_childs(struct dentry *dentry);
+static struct dentry* fs_splice_lookup(struct dentry *parent, const unsigned char *name, uint8_t name_len);
 
 static struct inode* fs_alloc_inode(struct super_block *sb);
 static void fs_destroy_inode(struct inode *inode);
 static void fs_destroy_inodes(struct super_block *sb);
+static inline uint32_t fs_hash_ino(uint64_t ino, uint32_t mask);
+static int32_t fs_grow_inodes(struct super_block *sb);
+static int32_t fs_hash_inode(struct super_block *sb, struct inode *inode);
+static void fs_unhash_inode(struct super_block *sb, struct inode *inode);
 static struct inode* fs_find_inode(struct super_block *sb, uint64_t ino);
+static inline uint32_t fs_hash_name(const struct dentry *parent, uint32_t hash, uint32_t mask);
+static int32_t fs_grow_dentries(struct super_block *sb);
+static int32_t fs_hash_dentry(struct super_block *sb, struct dentry *dentry);
+static void fs_unhash_dentry(struct dentry *dentry);
+static void fs_destroy_dentries(struct super_block *sb);
+static struct dentry* fs_find_dentry(struct dentry *parent, const char *name, uint32_t len);
 static struct inode* fs_instantiate_inode(struct inode *inode, uint64_t ino);
+static int32_t fs_read_inode(struct inode *inode);
+static struct inode* fs_iget(struct super_block *sb, uint64_t ino);
+static int32_t fs_get_parent(struct super_block *sb, uint64_t ino, uint64_t *parent);
 
 static struct dentry* fs_create_parent(struct super_block *sb, uint64_t ino, const unsigned char *name, uint8_t name_len);
-static struct dentry* fs_create_child(struct super_block *sb, struct dentry *parent, uint64_t ino, const unsigned char *name, uint8_t name_len);
+static uint16_t fs_ftype2imode(struct super_block *sb, uint8_t file_type);
+static struct dentry* fs_create_child(struct super_block *sb, struct dentry *parent, uint64_t ino, const unsigned char *name, uint8_t name_len, uint8_t file_type);
 static struct dentry* fs_make_root(struct super_block *sb);
 static int32_t fs_fill_super(struct super_block *sb);
 
 static struct dentry* fs_mount(struct file_system_type *type, uint64_t flags, const char *name, void *data);
-static int32_t fs_umount(const char *name, int32_t flags);
-static int32_t fs_traverse_dentry(struct dentry **dentry);
+static int32_t fs_umount(struct super_block *sb, int32_t flags);
+static int32_t fs_traverse_dentry(struct dentry **dentry, uint32_t num);
+static uint64_t fs_mem_used(struct super_block *sb);
+static int32_t fs_prune(struct super_block *sb, struct dentry *pin, struct inode *pin_inode);
+static int32_t fs_map_inode(struct inode *inode);
+static int32_t fs_lookup_dentry(struct dentry *parent, const char *name, uint32_t len, struct dentry **match);
 static int32_t fs_statfs(struct dentry *dentry, struct kstatfs *buf);
 static int32_t fs_statrawfs(struct dentry *dentry, const char **buf);
 static int32_t fs_statraw(struct inode *inode, const char **buf);
@@ -176,6 +220,33 @@ static struct super_operations fs_super_opt = {
 
   //.statraw =
   fs_statraw,
+
+  //.find_inode =
+  fs_find_inode,
+
+  //.find_dentry =
+  fs_find_dentry,
+
+  //.read_inode =
+  fs_read_inode,
+
+  //.iget =
+  fs_iget,
+
+  //.get_parent =
+  fs_get_parent,
+
+  //.prune =
+  fs_prune,
+
+  //.mem_used =
+  fs_mem_used,
+
+  //.map_inode =
+  fs_map_inode,
+
+  //.lookup_dentry =
+  fs_lookup_dentry,
 };
 
 static struct file_operations fs_file_opt = {
@@ -198,6 +269,20 @@ static struct file_operations fs_file_opt = {
   fs_readat,
 };
 
+static struct file_system_type fs_file_type = {
+  //.name =
+  "ext4",
+
+  //.fs_flags =
+  0,
+
+  //.mount =
+  fs_mount,
+
+  //.umount =
+  fs_umount,
+};
+
 /*
  * Function Definition
  */
@@ -244,64 +329,46 @@ static uint64_t fs_name_hash(const unsigned char *name, uint32_t len)
   return end_name_hash(hash);
 }
 
+/*
+ * Check if name is '.' or '..'
+ */
+static inline bool fs_is_dots(const unsigned char *name, uint8_t name_len)
+{
+  if (name_len == strlen(DNAME_DOT) && !memcmp((const void *)name, (const void *)DNAME_DOT, name_len)) {
+    return 1;
+  }
+
+  if (name_len == strlen(DNAME_DOTDOT) && !memcmp((const void *)name, (const void *)DNAME_DOTDOT, name_len)) {
+    return 1;
+  }
+
+  return 0;
+}
+
 /*
  * Allocate dentry
  */
 static struct dentry* fs_alloc_dentry(struct super_block *sb)
 {
   struct dentry *dentry = NULL;
-  struct qstr *q_name = NULL;
 
-  dentry = (struct dentry *)malloc(sizeof(struct dentry));
+  dentry = (struct dentry *)slab_alloc(&sb->s_dentry_slab);
   if (!dentry) {
     return NULL;
   }
-  memset((void *)dentry, 0, sizeof(struct dentry));
-
-  q_name = (struct qstr *)malloc(sizeof(struct qstr));
-  if (!q_name) {
-    goto fs_alloc_dentry_fail;
-  }
-  memset((void *)q_name, 0, sizeof(struct qstr));
-
-  q_name->name = (const unsigned char *)malloc(EXT4_NAME_LEN);
-  if (!q_name->name) {
-    goto fs_alloc_dentry_fail;
-  }
-  memset((void *)q_name->name, 0, EXT4_NAME_LEN);
-
-  q_name->len = (uint32_t)(strlen(DNAME_ROOT) > EXT4_NAME_LEN ? EXT4_NAME_LEN : strlen(DNAME_ROOT));
-  memcpy((void *)q_name->name, (const void *)DNAME_ROOT, q_name->len);
-  q_name->hash = (uint32_t)fs_name_hash(q_name->name, q_name->len);
 
   dentry->d_parent = dentry;
-  dentry->d_name = (struct qstr *)q_name;
+  dentry->d_name = NULL;
   dentry->d_op = sb->s_d_op;
   dentry->d_sb = sb;
   list_init(&dentry->d_child);
   list_init(&dentry->d_subdirs);
+  list_init(&dentry->d_alias);
+  list_init(&dentry->d_hash);
+  list_init(&dentry->d_lru);
+  list_init(&dentry->d_lookups);
 
   return dentry;
-
- fs_alloc_dentry_fail:
-
-  if (dentry) {
-    if (dentry->d_name->name) {
-      free((void *)dentry->d_name->name);
-      dentry->d_name->name = NULL;
-      dentry->d_name->len = 0;
-    }
-
-    if (dentry->d_name) {
-      free((void *)dentry->d_name);
-      dentry->d_name = NULL;
-    }
-
-    free((void *)dentry);
-    dentry = NULL;
-  }
-
-  return NULL;
 }
 
 /*
@@ -327,13 +394,19 @@ static struct dentry* fs_alloc_dentry_child(struct dentry *parent)
  */
 static void fs_d_release(struct dentry *dentry)
 {
+  struct super_block *sb = NULL;
+  struct inode *inode = NULL;
   struct dentry *child = NULL;
   struct list_head *ptr = NULL;
+  bool alias, populated;
 
   if (!dentry) {
     return;
   }
 
+  sb = dentry->d_sb;
+  populated = fs_is_populated(dentry);
+
   if (!list_empty(&dentry->d_subdirs)) {
 #if 0  // For CMAKE_COMPILER_IS_GNUCC only
     list_for_each_entry(child, &dentry->d_subdirs, d_child) {
@@ -347,21 +420,44 @@ static void fs_d_release(struct dentry *dentry)
     }
   }
 
-  if (dentry->d_name) {
-    if (dentry->d_name->name) {
-      free((void *)dentry->d_name->name);
-      dentry->d_name->name = NULL;
-      dentry->d_name->len = 0;
-    }
-    free((void *)dentry->d_name);
-    dentry->d_name = NULL;
+  /*
+   * Release child dentries looked up by index, which are not in tree yet
+   */
+  while (!list_empty(&dentry->d_lookups)) {
+    child = list_entry(dentry->d_lookups.next, struct dentry, d_child);
+    list_del_init(&child->d_child);
+    fs_d_release(child);
   }
 
-  if (dentry) {
-    free((void *)dentry);
-    dentry = NULL;
+  if (populated) {
+    fs_lru_depopulate(dentry);
   }
 
+  alias = list_empty(&dentry->d_alias) ? 0 : 1;
+  list_del_init(&dentry->d_alias);
+  fs_unhash_dentry(dentry);
+
+  /*
+   * Destroy inode along with the last dentry of it,
+   * as it is read from disk again on demand
+   */
+  inode = dentry->d_inode;
+  if (alias && inode && list_empty(&inode->i_dentry)) {
+    list_del_init(&inode->i_lru);
+    fs_unhash_inode(sb, inode);
+    sb->s_op->destroy_inode(inode);
+  }
+
+  /*
+   * Free name, unless it follows dentry
+   */
+  if (dentry->d_name && dentry->d_name != (struct qstr *)(dentry + 1)) {
+    slab_free(&sb->s_name_slab, (void *)dentry->d_name);
+  }
+  dentry->d_name = NULL;
+
+  slab_free(&sb->s_dentry_slab, (void *)dentry);
+
   return;
 }
 
@@ -370,27 +466,147 @@ static void fs_d_release(struct dentry *dentry)
  */
 static struct dentry* fs_instantiate_dentry(struct dentry *dentry, struct inode *inode, const unsigned char *name, uint8_t name_len)
 {
+  struct qstr *q_name = NULL;
+  uint32_t len;
+
   dentry->d_parent = (struct dentry *)dentry->d_parent;
 
-  dentry->d_name->name = (const unsigned char *)malloc(EXT4_NAME_LEN);
-  if (!dentry->d_name->name) {
-    return NULL;
+  /*
+   * Put qstr with short name following dentry,
+   * or allocate it with long name following it
+   */
+  len = (uint32_t)(name_len > EXT4_NAME_LEN ? EXT4_NAME_LEN : name_len);
+
+  if (len <= FS_DNAME_INLINE_LEN) {
+    q_name = (struct qstr *)(dentry + 1);
+  } else {
+    q_name = (struct qstr *)slab_alloc(&dentry->d_sb->s_name_slab);
+    if (!q_name) {
+      return NULL;
+    }
   }
-  memset((void *)dentry->d_name->name, 0, EXT4_NAME_LEN);
 
-  dentry->d_name->len = (uint32_t)(name_len > EXT4_NAME_LEN ? EXT4_NAME_LEN : name_len);
-  memcpy((void *)dentry->d_name->name, (const void *)name, dentry->d_name->len);
-  dentry->d_name->hash = (uint32_t)fs_name_hash(dentry->d_name->name, dentry->d_name->len);
+  q_name->name = (const unsigned char *)(q_name + 1);
+  q_name->len = len;
+  memcpy((void *)q_name->name, (const void *)name, len);
+  q_name->hash = (uint32_t)fs_name_hash(q_name->name, q_name->len);
+
+  dentry->d_name = q_name;
 
   dentry->d_inode = (struct inode *)inode;
   dentry->d_op = (const struct dentry_operations *)dentry->d_op;
   dentry->d_sb = (struct super_block *)dentry->d_sb;
-  memcpy((void *)&dentry->d_child, (const void *)&dentry->d_child, sizeof(struct list_head));
-  memcpy((void *)&dentry->d_subdirs, (const void *)&dentry->d_subdirs, sizeof(struct list_head));
+
+  /*
+   * Index dentry by inode, in order of instantiation,
+   * and skip '.' and '..' as aliases of parent and grandparent
+   */
+  if (!fs_is_dots(name, name_len)) {
+    list_add_tail(&dentry->d_alias, &inode->i_dentry);
+    list_del_init(&inode->i_lru);
+  }
 
   return dentry;
 }
 
+/*
+ * Check if directory has child dentries instantiated, by traversal or lookup by index
+ */
+static inline bool fs_is_populated(struct dentry *dentry)
+{
+  return dentry->d_pos > 0 || !list_empty(&dentry->d_lookups) ? 1 : 0;
+}
+
+/*
+ * Put directory into LRU list, once child dentries of it are instantiated,
+ * and take parent out of it, as parent has child directory with them now
+ */
+static void fs_lru_populate(struct dentry *dentry)
+{
+  struct super_block *sb = dentry->d_sb;
+  struct dentry *parent = dentry->d_parent;
+
+  if (parent != dentry) {
+    if (parent->d_dirnum == 0) {
+      list_del_init(&parent->d_lru);
+    }
+    parent->d_dirnum += 1;
+  }
+
+  list_add_tail(&dentry->d_lru, &sb->s_dentry_lru);
+}
+
+/*
+ * Take directory out of LRU list, once child dentries of it are released,
+ * and put parent back into it, if parent has no child directory with them
+ */
+static void fs_lru_depopulate(struct dentry *dentry)
+{
+  struct super_block *sb = dentry->d_sb;
+  struct dentry *parent = dentry->d_parent;
+
+  list_del_init(&dentry->d_lru);
+
+  if (parent != dentry) {
+    parent->d_dirnum -= 1;
+    if (parent->d_dirnum == 0 && fs_is_populated(parent)) {
+      list_add_tail(&parent->d_lru, &sb->s_dentry_lru);
+    }
+  }
+}
+
+/*
+ * Evict child dentries of directory, with inodes of them left without dentries,
+ * and keep directory in tree to be traversed again on demand
+ */
+static uint32_t fs_evict_childs(struct dentry *dentry)
+{
+  struct dentry *child = NULL;
+  uint32_t num = 0;
+
+  while (!list_empty(&dentry->d_subdirs)) {
+    child = list_entry(dentry->d_subdirs.next, struct dentry, d_child);
+    list_del_init(&child->d_child);
+    dentry->d_sb->s_d_op->d_release(child);
+    num += 1;
+  }
+
+  while (!list_empty(&dentry->d_lookups)) {
+    child = list_entry(dentry->d_lookups.next, struct dentry, d_child);
+    list_del_init(&child->d_child);
+    dentry->d_sb->s_d_op->d_release(child);
+    num += 1;
+  }
+
+  fs_lru_depopulate(dentry);
+
+  dentry->d_childnum = 0;
+  dentry->d_pos = 0;
+  dentry->d_complete = 0;
+
+  return num;
+}
+
+/*
+ * Move child dentry looked up by index into tree, once traversal reaches it,
+ * in the same order as ones instantiated by traversal
+ */
+static struct dentry* fs_splice_lookup(struct dentry *parent, const unsigned char *name, uint8_t name_len)
+{
+  struct dentry *child = NULL;
+
+  child = fs_find_dentry(parent, (const char *)name, name_len);
+  if (!child || !child->d_indexed) {
+    return NULL;
+  }
+
+  list_del_init(&child->d_child);
+  list_add(&child->d_child, &parent->d_subdirs);
+  child->d_indexed = 0;
+
+  return child;
+}
+
 /*
  * Allocate inode
  */
@@ -398,14 +614,14 @@ static struct inode* fs_alloc_inode(struct super_block *sb)
 {
   struct inode *inode = NULL;
 
-  inode = (struct inode *)malloc(sizeof(struct inode));
+  inode = (struct inode *)slab_alloc(&sb->s_inode_slab);
   if (!inode) {
     return NULL;
   }
-  memset((void *)inode, 0, sizeof(struct inode));
 
   inode->i_sb = sb;
-  list_add(&inode->i_sb_list, &inode->i_sb->s_inodes);
+  list_init(&inode->i_dentry);
+  list_init(&inode->i_lru);
 
   return inode;
 }
@@ -419,40 +635,155 @@ static void fs_destroy_inode(struct inode *inode)
     return;
   }
 
-  if (inode->i_block) {
-    free((void *)inode->i_block);
-    inode->i_block = NULL;
-  }
+  /*
+   * i_block is freed along with inode
+   */
+  inode->i_block = NULL;
 
-  if (inode) {
-    free((void *)inode);
-    inode = NULL;
+  if (inode->i_es) {
+    inode->i_sb->s_es_mem -= (uint64_t)inode->i_es_num * sizeof(struct extent_status);
+    free((void *)inode->i_es);
+    inode->i_es = NULL;
   }
+  inode->i_es_num = 0;
+  inode->i_mapped = 0;
+
+  slab_free(&inode->i_sb->s_inode_slab, (void *)inode);
 }
 
 /*
- * Destroy all inodes
+ * Destroy all inodes, and free hash table of them
  */
 static void fs_destroy_inodes(struct super_block *sb)
 {
-  struct inode *child = NULL;
-  struct list_head *ptr = NULL;
+  uint32_t i;
 
-  if (!list_empty(&sb->s_inodes)) {
-#if 0  // For CMAKE_COMPILER_IS_GNUCC only
-    list_for_each_entry(child, &sb->s_inodes, i_sb_list) {
-#else
-    for (child = list_entry((&sb->s_inodes)->next, struct inode, i_sb_list);
-         &child->i_sb_list != (&sb->s_inodes) && ptr;
-         child = list_entry(ptr, struct inode, i_sb_list)) {
-#endif
-      ptr = child->i_sb_list.next;
+  /*
+   * Free extents mapped on inodes, which are not in slab
+   */
+  for (i = 0; sb->s_inodes && i <= sb->s_inodes_mask; ++i) {
+    if (sb->s_inodes[i] && sb->s_inodes[i]->i_es) {
+      free((void *)sb->s_inodes[i]->i_es);
+      sb->s_inodes[i]->i_es = NULL;
+    }
+  }
+  sb->s_es_mem = 0;
+
+  slab_release(&sb->s_inode_slab);
 
-      if (!list_empty(&child->i_sb_list)) {
-        list_del_init(&child->i_sb_list);
+  if (!sb->s_inodes) {
+    return;
+  }
+
+  free((void *)sb->s_inodes);
+  sb->s_inodes = NULL;
+  sb->s_inodes_mask = 0;
+  sb->s_inodes_num = 0;
+}
+
+/*
+ * Hash ino into slot by Fibonacci hashing, as ino is mostly sequential
+ */
+static inline uint32_t fs_hash_ino(uint64_t ino, uint32_t mask)
+{
+  return (uint32_t)((ino * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+/*
+ * Grow hash table of inodes to double size, or to min size if empty
+ */
+static int32_t fs_grow_inodes(struct super_block *sb)
+{
+  struct inode **slots = NULL;
+  uint32_t num, mask, i, j;
+
+  num = sb->s_inodes ? (sb->s_inodes_mask + 1) << 1 : FS_INODES_NUM_MIN;
+  if (num == 0) {
+    return -1;
+  }
+  mask = num - 1;
+
+  slots = (struct inode **)calloc(num, sizeof(struct inode *));
+  if (!slots) {
+    return -1;
+  }
+
+  if (sb->s_inodes) {
+    for (i = 0; i <= sb->s_inodes_mask; ++i) {
+      if (!sb->s_inodes[i]) {
+        continue;
       }
 
-      sb->s_op->destroy_inode(child);
+      for (j = fs_hash_ino(sb->s_inodes[i]->i_ino, mask); slots[j]; j = (j + 1) & mask);
+      slots[j] = sb->s_inodes[i];
+    }
+
+    free((void *)sb->s_inodes);
+  }
+
+  sb->s_inodes = slots;
+  sb->s_inodes_mask = mask;
+
+  return 0;
+}
+
+/*
+ * Add instantiated inode into hash table of inodes
+ */
+static int32_t fs_hash_inode(struct super_block *sb, struct inode *inode)
+{
+  uint32_t i;
+
+  if (!sb->s_inodes || (sb->s_inodes_num + 1) > (sb->s_inodes_mask + 1) >> 1) {
+    if (fs_grow_inodes(sb) != 0) {
+      return -1;
+    }
+  }
+
+  for (i = fs_hash_ino(inode->i_ino, sb->s_inodes_mask); sb->s_inodes[i]; i = (i + 1) & sb->s_inodes_mask) {
+    if (sb->s_inodes[i]->i_ino == inode->i_ino) {
+      return -1;
+    }
+  }
+
+  sb->s_inodes[i] = inode;
+  sb->s_inodes_num += 1;
+
+  return 0;
+}
+
+/*
+ * Remove inode from hash table of inodes, if it is in,
+ * with inodes following it shifted back instead of leaving tombstone
+ */
+static void fs_unhash_inode(struct super_block *sb, struct inode *inode)
+{
+  uint32_t mask, i, j, k;
+
+  if (!sb->s_inodes) {
+    return;
+  }
+
+  mask = sb->s_inodes_mask;
+
+  for (i = fs_hash_ino(inode->i_ino, mask); sb->s_inodes[i] != inode; i = (i + 1) & mask) {
+    if (!sb->s_inodes[i]) {
+      return;
+    }
+  }
+
+  sb->s_inodes[i] = NULL;
+  sb->s_inodes_num -= 1;
+
+  /*
+   * Move inode into hole, if hole is between slot hashed of it and slot of it
+   */
+  for (j = (i + 1) & mask; sb->s_inodes[j]; j = (j + 1) & mask) {
+    k = fs_hash_ino(sb->s_inodes[j]->i_ino, mask);
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      sb->s_inodes[i] = sb->s_inodes[j];
+      sb->s_inodes[j] = NULL;
+      i = j;
     }
   }
 }
@@ -462,24 +793,146 @@ static void fs_destroy_inodes(struct super_block *sb)
  */
 static struct inode* fs_find_inode(struct super_block *sb, uint64_t ino)
 {
-  struct inode *child = NULL, *ptr = NULL;
+  struct inode *inode = NULL;
+  uint32_t i;
 
-  if (!list_empty(&sb->s_inodes)) {
-#if 0  // For CMAKE_COMPILER_IS_GNUCC only
-    list_for_each_entry(child, &sb->s_inodes, i_sb_list) {
-#else
-    for (child = list_entry((&sb->s_inodes)->next, struct inode, i_sb_list);
-         &child->i_sb_list != (&sb->s_inodes);
-         child = list_entry(child->i_sb_list.next, struct inode, i_sb_list)) {
-#endif
-      if (ino == child->i_ino) {
-        ptr = child;
-        break;
+  if (!sb || !sb->s_inodes) {
+    return NULL;
+  }
+
+  for (i = fs_hash_ino(ino, sb->s_inodes_mask); (inode = sb->s_inodes[i]) != NULL; i = (i + 1) & sb->s_inodes_mask) {
+    if (inode->i_ino == ino) {
+      return inode;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Hash parent and hash of name into bucket
+ */
+static inline uint32_t fs_hash_name(const struct dentry *parent, uint32_t hash, uint32_t mask)
+{
+  return fs_hash_ino((uint64_t)(uintptr_t)parent ^ ((uint64_t)hash << 32), mask);
+}
+
+/*
+ * Grow hash table of dentries to double size, or to min size if empty
+ */
+static int32_t fs_grow_dentries(struct super_block *sb)
+{
+  struct list_head *buckets = NULL;
+  struct dentry *dentry = NULL;
+  uint32_t num, mask, i;
+
+  num = sb->s_dentries ? (sb->s_dentries_mask + 1) << 1 : FS_DENTRIES_NUM_MIN;
+  if (num == 0) {
+    return -1;
+  }
+  mask = num - 1;
+
+  buckets = (struct list_head *)malloc(num * sizeof(struct list_head));
+  if (!buckets) {
+    return -1;
+  }
+
+  for (i = 0; i < num; ++i) {
+    list_init(&buckets[i]);
+  }
+
+  if (sb->s_dentries) {
+    for (i = 0; i <= sb->s_dentries_mask; ++i) {
+      while (!list_empty(&sb->s_dentries[i])) {
+        dentry = list_entry(sb->s_dentries[i].next, struct dentry, d_hash);
+        list_del_init(&dentry->d_hash);
+        list_add(&dentry->d_hash, &buckets[fs_hash_name(dentry->d_parent, dentry->d_name->hash, mask)]);
       }
     }
+
+    free((void *)sb->s_dentries);
   }
 
-  return ptr;
+  sb->s_dentries = buckets;
+  sb->s_dentries_mask = mask;
+
+  return 0;
+}
+
+/*
+ * Add instantiated child dentry into hash table of dentries
+ */
+static int32_t fs_hash_dentry(struct super_block *sb, struct dentry *dentry)
+{
+  if (!sb->s_dentries || sb->s_dentries_num + 1 > sb->s_dentries_mask + 1) {
+    if (fs_grow_dentries(sb) != 0) {
+      return -1;
+    }
+  }
+
+  list_add(&dentry->d_hash, &sb->s_dentries[fs_hash_name(dentry->d_parent, dentry->d_name->hash, sb->s_dentries_mask)]);
+  sb->s_dentries_num += 1;
+
+  return 0;
+}
+
+/*
+ * Remove dentry from hash table of dentries, if it is in
+ */
+static void fs_unhash_dentry(struct dentry *dentry)
+{
+  if (list_empty(&dentry->d_hash)) {
+    return;
+  }
+
+  list_del_init(&dentry->d_hash);
+  dentry->d_sb->s_dentries_num -= 1;
+}
+
+/*
+ * Free hash table of dentries, with dentries freed along with slab
+ */
+static void fs_destroy_dentries(struct super_block *sb)
+{
+  if (!sb->s_dentries) {
+    return;
+  }
+
+  free((void *)sb->s_dentries);
+  sb->s_dentries = NULL;
+  sb->s_dentries_mask = 0;
+  sb->s_dentries_num = 0;
+}
+
+/*
+ * Find child dentry of parent matched with name, among ones instantiated
+ */
+static struct dentry* fs_find_dentry(struct dentry *parent, const char *name, uint32_t len)
+{
+  struct super_block *sb = parent ? parent->d_sb : NULL;
+  struct list_head *bucket = NULL, *ptr = NULL;
+  struct dentry *dentry = NULL;
+  uint32_t hash;
+
+  if (!sb || !sb->s_dentries || !name) {
+    return NULL;
+  }
+
+  hash = (uint32_t)fs_name_hash((const unsigned char *)name, len);
+  bucket = &sb->s_dentries[fs_hash_name(parent, hash, sb->s_dentries_mask)];
+
+  for (ptr = bucket->next; ptr != bucket; ptr = ptr->next) {
+    dentry = list_entry(ptr, struct dentry, d_hash);
+
+    if (dentry->d_parent == parent
+        && dentry->d_name->hash == hash
+        && dentry->d_name->len == len
+        && !memcmp((const void *)dentry->d_name->name, (const void *)name, len)) {
+      return dentry;
+    }
+  }
+
+  return NULL;
 }
 
 /*
@@ -510,30 +963,136 @@ static struct inode* fs_instantiate_inode(struct inode *inode, uint64_t ino)
   inode->i_sb = (struct super_block *)sb;
   inode->i_ino = (uint64_t)ino;
 
-  memset((void *)&inode->i_atime, 0, sizeof(struct fs_timespec));
-  inode->i_atime.tv_sec = (int64_t)ext4_inode.i_atime;
-  memset((void *)&inode->i_mtime, 0, sizeof(struct fs_timespec));
-  inode->i_mtime.tv_sec = (int64_t)ext4_inode.i_mtime;
-  memset((void *)&inode->i_ctime, 0, sizeof(struct fs_timespec));
-  inode->i_ctime.tv_sec = (int64_t)ext4_inode.i_ctime;
+  memset((void *)&inode->i_atime, 0, sizeof(struct fs_timespec));
+  inode->i_atime.tv_sec = (int64_t)ext4_inode.i_atime;
+  memset((void *)&inode->i_mtime, 0, sizeof(struct fs_timespec));
+  inode->i_mtime.tv_sec = (int64_t)ext4_inode.i_mtime;
+  memset((void *)&inode->i_ctime, 0, sizeof(struct fs_timespec));
+  inode->i_ctime.tv_sec = (int64_t)ext4_inode.i_ctime;
+
+  inode->i_blocks = (uint64_t)(((uint64_t)ext4_inode.osd2.linux2.l_i_blocks_high << 32) | (uint64_t)ext4_inode.i_blocks_lo);
+  inode->i_size = (int64_t)(((int64_t)ext4_inode.i_size_high << 32) | (int64_t)ext4_inode.i_size_lo);
+  inode->i_count = (uint32_t)ext4_inode.i_links_count;
+  inode->i_version = (uint64_t)(((uint64_t)ext4_inode.i_version_hi << 32) | (uint64_t)ext4_inode.osd1.linux1.l_i_version);
+  inode->i_fop = (const struct file_operations *)&fs_file_opt;
+
+  /*
+   * i_block is allocated following inode in slab
+   */
+  inode->i_block = (uint32_t *)(inode + 1);
+  memcpy((void *)inode->i_block, (const void *)ext4_inode.i_block, EXT4_N_BLOCKS * sizeof(uint32_t));
+
+  inode->i_block_num = EXT4_N_BLOCKS;
+  inode->i_new = 0;
+
+  return inode;
+}
+
+/*
+ * Read inode from disk, if it is not read yet
+ */
+static int32_t fs_read_inode(struct inode *inode)
+{
+  if (!inode) {
+    return -1;
+  }
+
+  if (!inode->i_new) {
+    return 0;
+  }
+
+  return fs_instantiate_inode(inode, inode->i_ino) ? 0 : -1;
+}
+
+/*
+ * Get inode of ino read from disk, and instantiate it without dentry if not found,
+ * e.g., evicted along with dentries of it, and put it into LRU list
+ */
+static struct inode* fs_iget(struct super_block *sb, uint64_t ino)
+{
+  struct inode *inode = NULL;
+
+  if (!sb) {
+    return NULL;
+  }
+
+  inode = fs_find_inode(sb, ino);
+  if (inode) {
+    return fs_read_inode(inode) == 0 ? inode : NULL;
+  }
+
+  inode = sb->s_op->alloc_inode(sb);
+  if (!inode) {
+    return NULL;
+  }
+
+  /*
+   * Refuse inode not in use, as ino is given by caller
+   */
+  if (!fs_instantiate_inode(inode, ino) || inode->i_mode == 0 || inode->i_count == 0
+      || fs_hash_inode(sb, inode) != 0) {
+    sb->s_op->destroy_inode(inode);
+    return NULL;
+  }
+
+  list_add_tail(&inode->i_lru, &sb->s_inode_lru);
+
+  return inode;
+}
+
+/*
+ * Get ino of parent of directory of ino, from '..' in the first block of it
+ */
+static int32_t fs_get_parent(struct super_block *sb, uint64_t ino, uint64_t *parent)
+{
+  struct inode *inode = NULL;
+  struct ext4_dir_entry_2 *ext4_dentries = NULL;
+  uint32_t ext4_dentries_max, ext4_dentries_num, i;
+  int32_t ret;
+
+  if (!parent) {
+    return -1;
+  }
+
+  inode = fs_iget(sb, ino);
+  if (!inode || (inode->i_mode & 0xF000) != EXT4_INODE_MODE_S_IFDIR) {
+    return -1;
+  }
+
+  if (fs_map_inode(inode) != 0) {
+    return -1;
+  }
+
+  ext4_dentries_max = (uint32_t)(sb->s_blocksize / EXT4_DIR_REC_LEN(1));
+  ext4_dentries = (struct ext4_dir_entry_2 *)malloc(ext4_dentries_max * sizeof(struct ext4_dir_entry_2));
+  if (!ext4_dentries) {
+    return -1;
+  }
+
+  memset((void *)ext4_dentries, 0, ext4_dentries_max * sizeof(struct ext4_dir_entry_2));
+  ext4_dentries_num = 0;
 
-  inode->i_blocks = (uint64_t)(((uint64_t)ext4_inode.osd2.linux2.l_i_blocks_high << 32) | (uint64_t)ext4_inode.i_blocks_lo);
-  inode->i_size = (int64_t)(((int64_t)ext4_inode.i_size_high << 32) | (int64_t)ext4_inode.i_size_lo);
-  memcpy((void *)&inode->i_sb_list, (void *)&inode->i_sb_list, sizeof(struct list_head));
-  inode->i_count = (uint32_t)ext4_inode.i_links_count;
-  inode->i_version = (uint64_t)(((uint64_t)ext4_inode.i_version_hi << 32) | (uint64_t)ext4_inode.osd1.linux1.l_i_version);
-  inode->i_fop = (const struct file_operations *)&fs_file_opt;
+  ret = ext4_raw_dentry_block(inode, 0, ext4_dentries, ext4_dentries_max, &ext4_dentries_num);
+  if (ret != 0) {
+    goto fs_get_parent_exit;
+  }
 
-  inode->i_block = (uint32_t *)malloc(EXT4_N_BLOCKS * sizeof(uint32_t));
-  if (!inode->i_block) {
-    return NULL;
+  ret = -1;
+
+  for (i = 0; i < ext4_dentries_num; ++i) {
+    if (ext4_dentries[i].name_len == strlen(DNAME_DOTDOT)
+        && !memcmp((const void *)ext4_dentries[i].name, (const void *)DNAME_DOTDOT, ext4_dentries[i].name_len)) {
+      *parent = (uint64_t)ext4_dentries[i].inode;
+      ret = 0;
+      break;
+    }
   }
-  memset((void *)inode->i_block, 0, EXT4_N_BLOCKS * sizeof(uint32_t));
-  memcpy((void *)inode->i_block, (const void *)ext4_inode.i_block, EXT4_N_BLOCKS * sizeof(uint32_t));
 
-  inode->i_block_num = EXT4_N_BLOCKS;
+ fs_get_parent_exit:
 
-  return inode;
+  free((void *)ext4_dentries);
+
+  return ret;
 }
 
 /*
@@ -553,11 +1112,11 @@ static struct dentry* fs_create_parent(struct super_block *sb, uint64_t ino, con
   }
 
   /*
-   * Instantiate inode
+   * Instantiate inode, and add it into hash table of inodes
    */
-  inode = fs_instantiate_inode(inode, ino);
-  if (!inode) {
-    goto fs_create_parent_fail;
+  if (!fs_instantiate_inode(inode, ino) || fs_hash_inode(sb, inode) != 0) {
+    sb->s_op->destroy_inode(inode);
+    return NULL;
   }
 
   /*
@@ -590,24 +1149,73 @@ static struct dentry* fs_create_parent(struct super_block *sb, uint64_t ino, con
   return NULL;
 }
 
+/*
+ * Get type of file in bits of i_mode from file type of Ext4 dentry,
+ * or 0 if unknown, e.g., without file type in dentry on Ext2
+ */
+static uint16_t fs_ftype2imode(struct super_block *sb, uint8_t file_type)
+{
+  if (!EXT4_HAS_INCOMPAT_FEATURE(sb, EXT4_FEATURE_INCOMPAT_FILETYPE)) {
+    return 0;
+  }
+
+  if (file_type == EXT4_FT_REG_FILE) {
+    return EXT4_INODE_MODE_S_IFREG;
+  } else if (file_type == EXT4_FT_DIR) {
+    return EXT4_INODE_MODE_S_IFDIR;
+  } else if (file_type == EXT4_FT_CHRDEV) {
+    return EXT4_INODE_MODE_S_IFCHR;
+  } else if (file_type == EXT4_FT_BLKDEV) {
+    return EXT4_INODE_MODE_S_IFBLK;
+  } else if (file_type == EXT4_FT_FIFO) {
+    return EXT4_INODE_MODE_S_IFIFO;
+  } else if (file_type == EXT4_FT_SOCK) {
+    return EXT4_INODE_MODE_S_IFSOCK;
+  } else if (file_type == EXT4_FT_SYMLINK) {
+    return EXT4_INODE_MODE_S_IFLNK;
+  }
+
+  return 0;
+}
+
 /*
  * Allocate & instantiate child inode & dentry
+ *
+ * Inode is read from disk till stats of it are needed, if type of file
+ * is known from Ext4 dentry, so that listing directory reads its blocks only
  */
-static struct dentry* fs_create_child(struct super_block *sb, struct dentry *parent, uint64_t ino, const unsigned char *name, uint8_t name_len)
+static struct dentry* fs_create_child(struct super_block *sb, struct dentry *parent, uint64_t ino, const unsigned char *name, uint8_t name_len, uint8_t file_type)
 {
   struct inode *inode = NULL;
   struct dentry *child = NULL;
+  uint16_t mode;
+  bool alias;
 
+  /*
+   * Share inode among hard links
+   */
   inode = fs_find_inode(sb, ino);
   if (!inode) {
     inode = sb->s_op->alloc_inode(sb);
     if (!inode) {
-      goto fs_create_child_fail;
+      return NULL;
     }
 
-    inode = fs_instantiate_inode(inode, ino);
-    if (!inode) {
-      goto fs_create_child_fail;
+    mode = fs_ftype2imode(sb, file_type);
+    if (mode != 0) {
+      inode->i_mode = mode;
+      inode->i_op = (const struct inode_operations *)&fs_inode_opt;
+      inode->i_ino = ino;
+      inode->i_fop = (const struct file_operations *)&fs_file_opt;
+      inode->i_new = 1;
+    } else if (!fs_instantiate_inode(inode, ino)) {
+      sb->s_op->destroy_inode(inode);
+      return NULL;
+    }
+
+    if (fs_hash_inode(sb, inode) != 0) {
+      sb->s_op->destroy_inode(inode);
+      return NULL;
     }
   }
 
@@ -620,16 +1228,30 @@ static struct dentry* fs_create_child(struct super_block *sb, struct dentry *par
     goto fs_create_child_fail;
   }
 
+  if (fs_hash_dentry(sb, child) != 0) {
+    goto fs_create_child_fail;
+  }
+
   return child;
 
  fs_create_child_fail:
 
+  /*
+   * Keep inode in hash table, as it is owned by superblock,
+   * and put it into LRU list if it is left without dentries,
+   * unless it is destroyed along with child dentry as the last one of it
+   */
+  alias = child && !list_empty(&child->d_alias) ? 1 : 0;
+
   if (child) {
+    list_del_init(&child->d_child);
     sb->s_d_op->d_release(child);
     child = NULL;
   }
 
-  fs_destroy_inodes(sb);
+  if (!alias && list_empty(&inode->i_dentry) && list_empty(&inode->i_lru)) {
+    list_add_tail(&inode->i_lru, &sb->s_inode_lru);
+  }
 
   return NULL;
 }
@@ -639,54 +1261,24 @@ static struct dentry* fs_create_child(struct super_block *sb, struct dentry *par
  */
 static struct dentry* fs_make_root(struct super_block *sb)
 {
-  struct dentry *parent = NULL, *child = NULL;
-  struct ext4_dir_entry_2 *ext4_dentries = NULL;
-  uint32_t ext4_dentries_num, i;
-  struct dentry *ret = NULL;
+  struct dentry *parent = NULL;
 
   /*
    * Allocate & instantiate parent inode & dentry
    */
   parent = fs_create_parent(sb, (uint64_t)EXT4_ROOT_INO, (const unsigned char *)DNAME_ROOT, strlen(DNAME_ROOT));
   if (!parent) {
-    ret = NULL;
-    goto fs_make_root_fail;
-  }
-
-  /*
-   * Fill in Ext4 dentry
-   */
-  ext4_dentries_num = 0;
-  if (ext4_raw_dentry_num(parent, &ext4_dentries_num) != 0) {
-    ret = NULL;
-    goto fs_make_root_fail;
-  }
-
-  ext4_dentries = (struct ext4_dir_entry_2 *)malloc(ext4_dentries_num * sizeof(struct ext4_dir_entry_2));
-  if (!ext4_dentries) {
-    ret = NULL;
-    goto fs_make_root_fail;
-  }
-  memset((void *)ext4_dentries, 0, ext4_dentries_num * sizeof(struct ext4_dir_entry_2));
-
-  if (ext4_raw_dentry(parent, ext4_dentries, ext4_dentries_num) != 0) {
-    ret = NULL;
     goto fs_make_root_fail;
   }
 
   /*
    * Allocate & instantiate child inodes & dentries
    */
-  for (i = 0; i < ext4_dentries_num; ++i) {
-    child = fs_create_child(sb, parent, (uint64_t)ext4_dentries[i].inode, (const unsigned char *)ext4_dentries[i].name, ext4_dentries[i].name_len);
-    if (!child) {
-      ret = NULL;
-      goto fs_make_root_fail;
-    }
+  if (fs_traverse_dentry(&parent, UINT32_MAX) != 0) {
+    goto fs_make_root_fail;
   }
 
-  ret = parent;
-  goto fs_make_root_exit;
+  return parent;
 
  fs_make_root_fail:
 
@@ -696,15 +1288,9 @@ static struct dentry* fs_make_root(struct super_block *sb)
   }
 
   fs_destroy_inodes(sb);
+  fs_destroy_dentries(sb);
 
- fs_make_root_exit:
-
-  if (ext4_dentries) {
-    free((void *)ext4_dentries);
-    ext4_dentries = NULL;
-  }
-
-  return ret;
+  return NULL;
 }
 
 /*
@@ -720,7 +1306,7 @@ static int32_t fs_fill_super(struct super_block *sb)
    * Fill in Ext4 superblock
    */
   memset((void *)&ext4_sb, 0, sizeof(struct ext4_super_block));
-  ret = ext4_raw_super(&ext4_sb);
+  ret = ext4_raw_super(sb, &ext4_sb);
   if (ret != 0) {
     return -1;
   }
@@ -756,7 +1342,10 @@ static int32_t fs_fill_super(struct super_block *sb)
   }
 
   sb->s_d_op = (const struct dentry_operations *)&fs_dentry_opt;
-  list_init(&sb->s_inodes);
+
+  slab_init(&sb->s_dentry_slab, sizeof(struct dentry) + sizeof(struct qstr) + FS_DNAME_INLINE_LEN);
+  slab_init(&sb->s_inode_slab, sizeof(struct inode) + EXT4_N_BLOCKS * sizeof(uint32_t));
+  slab_init(&sb->s_name_slab, sizeof(struct qstr) + EXT4_NAME_LEN);
 
   sb->s_root = (struct dentry *)fs_make_root(sb);
   if (!sb->s_root) {
@@ -768,6 +1357,9 @@ static int32_t fs_fill_super(struct super_block *sb)
 
  fs_fill_super_fail:
 
+  slab_release(&sb->s_dentry_slab);
+  slab_release(&sb->s_name_slab);
+
   if (sb->s_fs_info) {
     free((void *)sb->s_fs_info);
     sb->s_fs_info = NULL;
@@ -781,10 +1373,12 @@ static int32_t fs_fill_super(struct super_block *sb)
  */
 static struct dentry* fs_mount(struct file_system_type *type, uint64_t flags, const char *name, void *data)
 {
+  struct mount_data *md = (struct mount_data *)data;
+  struct super_block *sb = NULL;
+  struct io_ctx *ctx = NULL;
   int32_t ret;
 
   flags = flags;
-  data = data;
 
   if (!type || !name) {
     return NULL;
@@ -793,27 +1387,55 @@ static struct dentry* fs_mount(struct file_system_type *type, uint64_t flags, co
   /*
    * Open filesystem
    */
-  ret = io_open(name);
-  if (ret != 0) {
+  ctx = io_open(name);
+  if (!ctx) {
     return NULL;
   }
 
   /*
-   * Fill in superblock
+   * Allocate & fill in superblock, one per mount
    */
-  memset((void *)&fs_sb, 0, sizeof(struct super_block));
-  ret = fs_fill_super(&fs_sb);
+  sb = (struct super_block *)malloc(sizeof(struct super_block));
+  if (!sb) {
+    goto fs_mount_fail;
+  }
+  memset((void *)sb, 0, sizeof(struct super_block));
+  sb->s_io = ctx;
+  list_init(&sb->s_dentry_lru);
+  list_init(&sb->s_inode_lru);
+  sb->s_mem_budget = md ? md->md_mem_budget : 0;
+
+  ret = fs_fill_super(sb);
   if (ret != 0) {
     goto fs_mount_fail;
   }
 
-  return fs_sb.s_root;
+  /*
+   * Cache metadata blocks of filesystem if not mapped in memory by IO,
+   * and keep on mounting without cache if no memory
+   */
+  if ((!md || !md->md_nocache) && !io_map(ctx, 0, (int64_t)sb->s_blocksize)) {
+    (void)io_cache_init(ctx, (int64_t)sb->s_blocksize, md ? md->md_cache_blks : 0);
+  }
+
+  /*
+   * Read bulk file data by direct IO if asked,
+   * and fall back to buffered IO if not supported
+   */
+  if (md && md->md_direct) {
+    (void)io_direct_init(ctx);
+  }
+
+  return sb->s_root;
 
  fs_mount_fail:
 
-  memset((void *)&fs_sb, 0, sizeof(struct super_block));
+  if (sb) {
+    free((void *)sb);
+    sb = NULL;
+  }
 
-  (void)io_close();
+  io_close(ctx);
 
   return NULL;
 }
@@ -821,63 +1443,67 @@ static struct dentry* fs_mount(struct file_system_type *type, uint64_t flags, co
 /*
  * Unmount filesystem
  */
-static int32_t fs_umount(const char *name, int32_t flags)
+static int32_t fs_umount(struct super_block *sb, int32_t flags)
 {
-  name = name;
+  struct io_ctx *ctx = NULL;
+
   flags = flags;
 
+  if (!sb) {
+    return -1;
+  }
+
+  ctx = sb->s_io;
+
   /*
-   * Free list of dentry
+   * Free all dentries and names at once, instead of releasing tree of dentry
    */
-  if (fs_sb.s_d_op && fs_sb.s_d_op->d_release && fs_sb.s_root) {
-    fs_sb.s_d_op->d_release(fs_sb.s_root);
-    fs_sb.s_root = NULL;
-  }
+  sb->s_root = NULL;
+  fs_destroy_dentries(sb);
+  slab_release(&sb->s_dentry_slab);
+  slab_release(&sb->s_name_slab);
 
   /*
-   * Free list of inode
+   * Free all inodes at once
    */
-  fs_destroy_inodes(&fs_sb);
+  fs_destroy_inodes(sb);
 
-  if (fs_sb.s_fs_info) {
-    if (((struct ext4_sb_info *)fs_sb.s_fs_info)->s_group_desc) {
-      free((void *)((struct ext4_sb_info *)fs_sb.s_fs_info)->s_group_desc);
-      ((struct ext4_sb_info *)fs_sb.s_fs_info)->s_group_desc = NULL;
+  if (sb->s_fs_info) {
+    if (((struct ext4_sb_info *)sb->s_fs_info)->s_group_desc) {
+      free((void *)((struct ext4_sb_info *)sb->s_fs_info)->s_group_desc);
+      ((struct ext4_sb_info *)sb->s_fs_info)->s_group_desc = NULL;
     }
 
-    if (((struct ext4_sb_info *)fs_sb.s_fs_info)->s_es) {
-      free((void *)((struct ext4_sb_info *)fs_sb.s_fs_info)->s_es);
-      ((struct ext4_sb_info *)fs_sb.s_fs_info)->s_es = NULL;
+    if (((struct ext4_sb_info *)sb->s_fs_info)->s_es) {
+      free((void *)((struct ext4_sb_info *)sb->s_fs_info)->s_es);
+      ((struct ext4_sb_info *)sb->s_fs_info)->s_es = NULL;
     }
 
-    free((void *)fs_sb.s_fs_info);
-    fs_sb.s_fs_info = NULL;
+    free((void *)sb->s_fs_info);
+    sb->s_fs_info = NULL;
   }
 
-  /*
-   * No malloc here
-   */
-  fs_sb.s_type = NULL;
-  fs_sb.s_op = NULL;
-  fs_sb.s_d_op = NULL;
-
-  memset((void *)&fs_sb, 0, sizeof(struct super_block));
+  memset((void *)sb, 0, sizeof(struct super_block));
+  free((void *)sb);
 
-  (void)io_close();
+  io_close(ctx);
 
   return 0;
 }
 
 /*
- * Traverse dentry for child dentries
+ * Traverse dentry for child dentries block by block,
+ * till num of them are traversed at least, or all blocks are traversed
  */
-static int32_t fs_traverse_dentry(struct dentry **dentry)
+static int32_t fs_traverse_dentry(struct dentry **dentry, uint32_t num)
 {
   struct super_block *sb = NULL;
   struct inode *inode = NULL;
   struct dentry *child = NULL;
   struct ext4_dir_entry_2 *ext4_dentries = NULL;
-  uint32_t ext4_dentries_num, i;
+  uint32_t ext4_dentries_max, ext4_dentries_num, i;
+  uint64_t blocks;
+  bool populated;
   int32_t ret;
 
   if (!dentry || !*dentry) {
@@ -890,53 +1516,95 @@ static int32_t fs_traverse_dentry(struct dentry **dentry)
     return -1;
   }
 
-  if (!((inode->i_mode & 0xF000) == EXT4_INODE_MODE_S_IFDIR)) {
+  if (!((inode->i_mode & 0xF000) == EXT4_INODE_MODE_S_IFDIR) || (*dentry)->d_complete) {
     return 0;
   }
 
   /*
-   * Fill in Ext4 dentry
+   * Read inode of directory, and map extents of it for blocks of it
    */
-  ext4_dentries_num = 0;
-  if (ext4_raw_dentry_num(*dentry, &ext4_dentries_num) != 0) {
-    ret = -1;
-    goto fs_traverse_dentry_fail;
+  if (fs_map_inode(inode) != 0) {
+    return -1;
   }
 
-  ext4_dentries = (struct ext4_dir_entry_2 *)malloc(ext4_dentries_num * sizeof(struct ext4_dir_entry_2));
+  /*
+   * Allocate Ext4 dentries of one block
+   */
+  ext4_dentries_max = (uint32_t)(sb->s_blocksize / EXT4_DIR_REC_LEN(1));
+  ext4_dentries = (struct ext4_dir_entry_2 *)malloc(ext4_dentries_max * sizeof(struct ext4_dir_entry_2));
   if (!ext4_dentries) {
-    ret = -1;
-    goto fs_traverse_dentry_fail;
-  }
-  memset((void *)ext4_dentries, 0, ext4_dentries_num * sizeof(struct ext4_dir_entry_2));
-
-  if (ext4_raw_dentry(*dentry, ext4_dentries, ext4_dentries_num) != 0) {
-    ret = -1;
-    goto fs_traverse_dentry_fail;
+    return -1;
   }
 
-  /*
-   * Allocate & instantiate child inodes & dentries
-   */
-  for (i = 0; i < ext4_dentries_num; ++i) {
-    child = fs_create_child(sb, *dentry, (uint64_t)ext4_dentries[i].inode, (const unsigned char *)ext4_dentries[i].name, ext4_dentries[i].name_len);
-    if (!child) {
+  blocks = ((uint64_t)inode->i_size + sb->s_blocksize - 1) / sb->s_blocksize;
+  ext4_dentries_num = 0;
+  populated = fs_is_populated(*dentry);
+
+  while ((*dentry)->d_pos < blocks && (*dentry)->d_childnum < num) {
+    /*
+     * Fill in Ext4 dentries of block
+     */
+    memset((void *)ext4_dentries, 0, ext4_dentries_max * sizeof(struct ext4_dir_entry_2));
+    ext4_dentries_num = 0;
+    if (ext4_raw_dentry_block(inode, (*dentry)->d_pos, ext4_dentries, ext4_dentries_max, &ext4_dentries_num) != 0) {
       ret = -1;
       goto fs_traverse_dentry_fail;
     }
+
+    /*
+     * Allocate & instantiate child inodes & dentries,
+     * or take ones looked up by index already
+     */
+    for (i = 0; i < ext4_dentries_num; ++i) {
+      child = NULL;
+      if (!list_empty(&(*dentry)->d_lookups)) {
+        child = fs_splice_lookup(*dentry, (const unsigned char *)ext4_dentries[i].name, ext4_dentries[i].name_len);
+      }
+
+      if (!child) {
+        child = fs_create_child(sb, *dentry, (uint64_t)ext4_dentries[i].inode, (const unsigned char *)ext4_dentries[i].name, ext4_dentries[i].name_len, ext4_dentries[i].file_type);
+      }
+
+      if (!child) {
+        ext4_dentries_num = i;
+        ret = -1;
+        goto fs_traverse_dentry_fail;
+      }
+    }
+
+    (*dentry)->d_childnum += ext4_dentries_num;
+    (*dentry)->d_pos += 1;
+
+    if (!populated) {
+      fs_lru_populate(*dentry);
+      populated = 1;
+    }
   }
 
+  (*dentry)->d_complete = (*dentry)->d_pos >= blocks ? 1 : 0;
+
   ret = 0;
   goto fs_traverse_dentry_exit;
 
  fs_traverse_dentry_fail:
 
-  if (*dentry) {
-    sb->s_d_op->d_release(*dentry);
-    *dentry = NULL;
+  /*
+   * Release child dentries of block traversed partially, and keep dentry in tree,
+   * as it and inodes are still indexed, with blocks traversed before kept
+   */
+  for (i = 0; i < ext4_dentries_num && !list_empty(&(*dentry)->d_subdirs); ++i) {
+    child = list_entry((*dentry)->d_subdirs.next, struct dentry, d_child);
+    list_del_init(&child->d_child);
+    sb->s_d_op->d_release(child);
   }
 
-  fs_destroy_inodes(sb);
+  /*
+   * Take dentry out of LRU list, if ones looked up by index taken and released
+   * above are all of child dentries of it
+   */
+  if (populated && !fs_is_populated(*dentry)) {
+    fs_lru_depopulate(*dentry);
+  }
 
  fs_traverse_dentry_exit:
 
@@ -948,6 +1616,214 @@ static int32_t fs_traverse_dentry(struct dentry **dentry)
   return ret;
 }
 
+/*
+ * Get memory of dentries, inodes, extents mapped on inodes and hash tables in use
+ */
+static uint64_t fs_mem_used(struct super_block *sb)
+{
+  uint64_t mem;
+
+  if (!sb) {
+    return 0;
+  }
+
+  mem = (uint64_t)sb->s_dentry_slab.obj_num * sb->s_dentry_slab.obj_sz;
+  mem += (uint64_t)sb->s_inode_slab.obj_num * sb->s_inode_slab.obj_sz;
+  mem += (uint64_t)sb->s_name_slab.obj_num * sb->s_name_slab.obj_sz;
+  mem += sb->s_es_mem;
+
+  if (sb->s_inodes) {
+    mem += (uint64_t)(sb->s_inodes_mask + 1) * sizeof(struct inode *);
+  }
+
+  if (sb->s_dentries) {
+    mem += (uint64_t)(sb->s_dentries_mask + 1) * sizeof(struct list_head);
+  }
+
+  return mem;
+}
+
+/*
+ * Evict child dentries of directories least recently used, and then inodes
+ * without dentries, till memory of them is within budget
+ *
+ * Ones accessed since put into LRU list are given second chance, and ones of pin
+ * are kept, as well as ancestors of pin, which are not in LRU list,
+ * and eviction stops once nothing changes between pin met twice
+ */
+static int32_t fs_prune(struct super_block *sb, struct dentry *pin, struct inode *pin_inode)
+{
+  struct dentry *dentry = NULL;
+  struct inode *inode = NULL;
+  bool seen, changed;
+
+  if (!sb) {
+    return -1;
+  }
+
+  if (sb->s_mem_budget == 0) {
+    return 0;
+  }
+
+  seen = changed = 0;
+
+  while (fs_mem_used(sb) > sb->s_mem_budget && !list_empty(&sb->s_dentry_lru)) {
+    dentry = list_entry(sb->s_dentry_lru.next, struct dentry, d_lru);
+
+    if (dentry == pin) {
+      if (seen && !changed) {
+        break;
+      }
+      seen = 1;
+      changed = 0;
+    } else if (atomic_load32(&dentry->d_referenced)) {
+      atomic_store32(&dentry->d_referenced, 0);
+      changed = 1;
+    } else {
+      sb->s_evicts += fs_evict_childs(dentry);
+      changed = 1;
+      continue;
+    }
+
+    list_del_init(&dentry->d_lru);
+    list_add_tail(&dentry->d_lru, &sb->s_dentry_lru);
+  }
+
+  seen = changed = 0;
+
+  while (fs_mem_used(sb) > sb->s_mem_budget && !list_empty(&sb->s_inode_lru)) {
+    inode = list_entry(sb->s_inode_lru.next, struct inode, i_lru);
+
+    if (inode == pin_inode) {
+      if (seen && !changed) {
+        break;
+      }
+      seen = 1;
+      changed = 0;
+    } else if (atomic_load32(&inode->i_referenced)) {
+      atomic_store32(&inode->i_referenced, 0);
+      changed = 1;
+    } else {
+      list_del_init(&inode->i_lru);
+      fs_unhash_inode(sb, inode);
+      sb->s_op->destroy_inode(inode);
+      sb->s_evicts += 1;
+      changed = 1;
+      continue;
+    }
+
+    list_del_init(&inode->i_lru);
+    list_add_tail(&inode->i_lru, &sb->s_inode_lru);
+  }
+
+  return 0;
+}
+
+/*
+ * Look up child dentry of parent matched with name by index of directory,
+ * and instantiate it ahead of traversal, with match of NULL if not found,
+ * or return -1 if directory is not indexed, and it is to be traversed instead
+ */
+static int32_t fs_lookup_dentry(struct dentry *parent, const char *name, uint32_t len, struct dentry **match)
+{
+  struct super_block *sb = NULL;
+  struct inode *inode = NULL;
+  struct dentry *child = NULL;
+  struct ext4_dir_entry_2 ext4_dentry;
+  bool populated;
+  int32_t ret;
+
+  if (!parent || !name || !match) {
+    return -1;
+  }
+
+  *match = NULL;
+
+  sb = parent->d_sb;
+  inode = parent->d_inode;
+  if (!sb || !inode || (inode->i_mode & 0xF000) != EXT4_INODE_MODE_S_IFDIR) {
+    return -1;
+  }
+
+  /*
+   * '.' and '..' are in the first block, out of index
+   */
+  if (len > EXT4_NAME_LEN || fs_is_dots((const unsigned char *)name, (uint8_t)len)) {
+    return -1;
+  }
+
+  if (fs_map_inode(inode) != 0) {
+    return -1;
+  }
+
+  memset((void *)&ext4_dentry, 0, sizeof(struct ext4_dir_entry_2));
+
+  ret = ext4_dx_find_dentry(inode, name, len, &ext4_dentry);
+  if (ret != 0) {
+    return ret > 0 ? 0 : -1;
+  }
+
+  populated = fs_is_populated(parent);
+
+  child = fs_create_child(sb, parent, (uint64_t)ext4_dentry.inode, (const unsigned char *)ext4_dentry.name, ext4_dentry.name_len, ext4_dentry.file_type);
+  if (!child) {
+    return -1;
+  }
+
+  list_del_init(&child->d_child);
+  list_add(&child->d_child, &parent->d_lookups);
+  child->d_indexed = 1;
+
+  if (!populated) {
+    fs_lru_populate(parent);
+  }
+
+  *match = child;
+
+  return 0;
+}
+
+/*
+ * Read inode, and map extents of it once, which are kept along with it
+ * till it is destroyed, as they are looked up on every read of blocks
+ */
+static int32_t fs_map_inode(struct inode *inode)
+{
+  struct extent_status *es = NULL;
+  uint32_t es_num = 0;
+  uint16_t mode;
+
+  if (fs_read_inode(inode) != 0) {
+    return -1;
+  }
+
+  if (inode->i_mapped) {
+    return 0;
+  }
+
+  /*
+   * Inode without blocks, e.g., fast symlink, device, or inode with data inline,
+   * is mapped with nothing in map
+   */
+  mode = inode->i_mode & 0xF000;
+  if ((mode == EXT4_INODE_MODE_S_IFREG
+       || mode == EXT4_INODE_MODE_S_IFDIR
+       || (mode == EXT4_INODE_MODE_S_IFLNK && inode->i_size >= (int64_t)(EXT4_N_BLOCKS * sizeof(uint32_t))))
+      && !(inode->i_flags & EXT4_INLINE_DATA_FL)) {
+    if (ext4_map_blocks(inode, &es, &es_num) != 0) {
+      return -1;
+    }
+  }
+
+  inode->i_es = es;
+  inode->i_es_num = es_num;
+  inode->i_mapped = 1;
+
+  inode->i_sb->s_es_mem += (uint64_t)es_num * sizeof(struct extent_status);
+
+  return 0;
+}
+
 /*
  * Show stats of filesystem
  */
@@ -964,7 +1840,7 @@ static int32_t fs_statfs(struct dentry *dentry, struct kstatfs *buf)
    * Fill in Ext4 superblock
    */
   memset((void *)&ext4_sb, 0, sizeof(struct ext4_super_block));
-  ret = ext4_raw_super(&ext4_sb);
+  ret = ext4_raw_super(dentry->d_sb, &ext4_sb);
   if (ret != 0) {
     return -1;
   }
@@ -1006,7 +1882,7 @@ static int32_t fs_statrawfs(struct dentry *dentry, const char **buf)
    * Fill in Ext4 superblock
    */
   memset((void *)&ext4_sb, 0, sizeof(struct ext4_super_block));
-  ret = ext4_raw_super(&ext4_sb);
+  ret = ext4_raw_super(dentry->d_sb, &ext4_sb);
   if (ret != 0) {
     return -1;
   }
@@ -1137,15 +2013,14 @@ static int32_t fs_readat(struct file *file, int64_t offset, char *buf, size_t bu
  */
 struct file_system_type* fs_file_system_type_init_ext4(const char *type, int32_t flags)
 {
+  flags = flags;
+
   if (!type) {
     return NULL;
   }
 
-  memset((void *)&fs_file_type, 0, sizeof(struct file_system_type));
-  fs_file_type.name = type;
-  fs_file_type.fs_flags = flags;
-  fs_file_type.mount = fs_mount;
-  fs_file_type.umount = fs_umount;
-
+  /*
+   * Shared by all mounts, with no state of mount
+   */
   return &fs_file_type;
 }
@@ -0,0 +1,285 @@
+/**
+ * hash.c - hash of directory index of Ext4.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_LIBEXT4_HASH
+#endif
+
+#include "include/base/debug.h"
+#include "include/base/types.h"
+#include "include/libio/io.h"
+#include "include/libext4/libext4.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * Refer to kernel/fs/ext4/hash.c
+ */
+#define DELTA  0x9E3779B9
+
+/*
+ * Basic MD4 functions: selection, majority, parity
+ */
+#define F(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z)  (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z)  ((x) ^ (y) ^ (z))
+
+#define ROL32(x, s)  (((x) << (s)) | ((x) >> (32 - (s))))
+
+#define ROUND(f, a, b, c, d, x, s)  (a += f(b, c, d) + x, a = ROL32(a, s))
+
+#define K1  0
+#define K2  013240474631UL
+#define K3  015666365641UL
+
+/*
+ * Type Definition
+ */
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static void ext4_tea_transform(uint32_t buf[4], const uint32_t in[]);
+static uint32_t ext4_half_md4_transform(uint32_t buf[4], const uint32_t in[8]);
+static uint32_t ext4_dx_hack_hash(const char *name, int32_t len, bool is_unsigned);
+static void ext4_str2hashbuf(const char *msg, uint32_t len, uint32_t *buf, uint32_t num, bool is_unsigned);
+
+/*
+ * Function Definition
+ */
+/*
+ * TEA transform of 16 rounds
+ */
+static void ext4_tea_transform(uint32_t buf[4], const uint32_t in[])
+{
+  uint32_t sum = 0;
+  uint32_t b0 = buf[0], b1 = buf[1];
+  uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+  int32_t n = 16;
+
+  do {
+    sum += DELTA;
+    b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+    b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+  } while (--n);
+
+  buf[0] += b0;
+  buf[1] += b1;
+}
+
+/*
+ * Cut-down version of MD4 transform, with the most hashed word returned
+ */
+static uint32_t ext4_half_md4_transform(uint32_t buf[4], const uint32_t in[8])
+{
+  uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+  /*
+   * Round 1
+   */
+  ROUND(F, a, b, c, d, in[0] + K1,  3);
+  ROUND(F, d, a, b, c, in[1] + K1,  7);
+  ROUND(F, c, d, a, b, in[2] + K1, 11);
+  ROUND(F, b, c, d, a, in[3] + K1, 19);
+  ROUND(F, a, b, c, d, in[4] + K1,  3);
+  ROUND(F, d, a, b, c, in[5] + K1,  7);
+  ROUND(F, c, d, a, b, in[6] + K1, 11);
+  ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+  /*
+   * Round 2
+   */
+  ROUND(G, a, b, c, d, in[1] + K2,  3);
+  ROUND(G, d, a, b, c, in[3] + K2,  5);
+  ROUND(G, c, d, a, b, in[5] + K2,  9);
+  ROUND(G, b, c, d, a, in[7] + K2, 13);
+  ROUND(G, a, b, c, d, in[0] + K2,  3);
+  ROUND(G, d, a, b, c, in[2] + K2,  5);
+  ROUND(G, c, d, a, b, in[4] + K2,  9);
+  ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+  /*
+   * Round 3
+   */
+  ROUND(H, a, b, c, d, in[3] + K3,  3);
+  ROUND(H, d, a, b, c, in[7] + K3,  9);
+  ROUND(H, c, d, a, b, in[2] + K3, 11);
+  ROUND(H, b, c, d, a, in[6] + K3, 15);
+  ROUND(H, a, b, c, d, in[1] + K3,  3);
+  ROUND(H, d, a, b, c, in[5] + K3,  9);
+  ROUND(H, c, d, a, b, in[0] + K3, 11);
+  ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+  buf[0] += a;
+  buf[1] += b;
+  buf[2] += c;
+  buf[3] += d;
+
+  return buf[1];
+}
+
+/*
+ * Legacy hash, with chars of name signed or unsigned
+ */
+static uint32_t ext4_dx_hack_hash(const char *name, int32_t len, bool is_unsigned)
+{
+  uint32_t hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+  int32_t i, c;
+
+  for (i = 0; i < len; ++i) {
+    c = is_unsigned ? (int32_t)((const unsigned char *)name)[i] : (int32_t)((const signed char *)name)[i];
+    hash = hash1 + (hash0 ^ (uint32_t)(c * 7152373));
+
+    if (hash & 0x80000000) {
+      hash -= 0x7fffffff;
+    }
+
+    hash1 = hash0;
+    hash0 = hash;
+  }
+
+  return hash0 << 1;
+}
+
+/*
+ * Pack name into num of words, padded with length of name,
+ * with chars of name signed or unsigned
+ */
+static void ext4_str2hashbuf(const char *msg, uint32_t len, uint32_t *buf, uint32_t num, bool is_unsigned)
+{
+  uint32_t pad, val, i;
+  int32_t c;
+
+  pad = len | (len << 8);
+  pad |= pad << 16;
+
+  val = pad;
+
+  if (len > num * 4) {
+    len = num * 4;
+  }
+
+  for (i = 0; i < len; ++i) {
+    c = is_unsigned ? (int32_t)((const unsigned char *)msg)[i] : (int32_t)((const signed char *)msg)[i];
+    val = (uint32_t)c + (val << 8);
+
+    if ((i % 4) == 3) {
+      *buf++ = val;
+      val = pad;
+      num--;
+    }
+  }
+
+  if (num > 0) {
+    *buf++ = val;
+    num--;
+  }
+
+  while (num > 0) {
+    *buf++ = pad;
+    num--;
+  }
+}
+
+/*
+ * Hash name of dentry by hash version and seed of hinfo, into hash and minor hash of it,
+ * refer to 'ext4fs_dirhash' in kernel/fs/ext4/hash.c
+ */
+int32_t ext4fs_dirhash(const char *name, int32_t len, struct dx_hash_info *hinfo)
+{
+  uint32_t hash, minor_hash = 0;
+  uint32_t in[8], buf[4];
+  const char *p = NULL;
+  bool is_unsigned;
+  int32_t i;
+
+  /*
+   * Initialize the default seed for the hash checksum functions
+   */
+  buf[0] = 0x67452301;
+  buf[1] = 0xefcdab89;
+  buf[2] = 0x98badcfe;
+  buf[3] = 0x10325476;
+
+  /*
+   * Check to see if the seed is all zero's
+   */
+  if (hinfo->seed) {
+    for (i = 0; i < 4; ++i) {
+      if (hinfo->seed[i]) {
+        memcpy((void *)buf, (const void *)hinfo->seed, sizeof(buf));
+        break;
+      }
+    }
+  }
+
+  is_unsigned = hinfo->hash_version >= DX_HASH_LEGACY_UNSIGNED ? 1 : 0;
+
+  switch (hinfo->hash_version) {
+  case DX_HASH_LEGACY:
+  case DX_HASH_LEGACY_UNSIGNED:
+    hash = ext4_dx_hack_hash(name, len, is_unsigned);
+    break;
+  case DX_HASH_HALF_MD4:
+  case DX_HASH_HALF_MD4_UNSIGNED:
+    for (p = name; len > 0; len -= 32, p += 32) {
+      ext4_str2hashbuf(p, (uint32_t)len, in, 8, is_unsigned);
+      (void)ext4_half_md4_transform(buf, in);
+    }
+    minor_hash = buf[2];
+    hash = buf[1];
+    break;
+  case DX_HASH_TEA:
+  case DX_HASH_TEA_UNSIGNED:
+    for (p = name; len > 0; len -= 16, p += 16) {
+      ext4_str2hashbuf(p, (uint32_t)len, in, 4, is_unsigned);
+      ext4_tea_transform(buf, in);
+    }
+    hash = buf[0];
+    minor_hash = buf[1];
+    break;
+  default:
+    hinfo->hash = 0;
+    return -1;
+  }
+
+  hash = hash & ~1;
+  if (hash == (EXT4_HTREE_EOF_32BIT << 1)) {
+    hash = (EXT4_HTREE_EOF_32BIT - 1) << 1;
+  }
+
+  hinfo->hash = hash;
+  hinfo->minor_hash = minor_hash;
+
+  return 0;
+}
@@ -0,0 +1,280 @@
+/**
+ * indirect.c - indirect block of Ext4.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_LIBEXT4_INDIRECT
+#endif
+
+#include "include/base/debug.h"
+#include "include/base/types.h"
+#include "include/libio/io.h"
+#include "include/libext4/libext4.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * Levels of indirect blocks, i.e., indirect, double-indirect and triple-indirect
+ */
+#define EXT4_IND_DEPTH_MAX  (3)
+
+/*
+ * Type Definition
+ */
+/*
+ * Context of walk of indirect blocks, with buffer of block size per level
+ * for blocks not mapped in place, so that block of upper level is kept
+ * while lower levels are walked, and map of runs built so far
+ */
+struct ext4_ind_walk {
+  struct inode *inode;
+  uint64_t blocks_count;
+  uint64_t lblks;
+  uint8_t *blks[EXT4_IND_DEPTH_MAX];
+  struct extent_status *es;
+  uint32_t es_num;
+  uint32_t es_max;
+};
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static int32_t ext4_ind_add(struct ext4_ind_walk *walk, uint64_t lblk, uint64_t pblk);
+static const uint32_t* ext4_ind_block(struct ext4_ind_walk *walk, uint64_t pblk, int32_t depth);
+static int32_t ext4_ind_map_block(struct ext4_ind_walk *walk, uint64_t pblk, int32_t depth, uint64_t lblk);
+
+/*
+ * Function Definition
+ */
+/*
+ * Add block mapped to map, merged into the last run if contiguous with it,
+ * so that contiguous blocks are read in one IO
+ */
+static int32_t ext4_ind_add(struct ext4_ind_walk *walk, uint64_t lblk, uint64_t pblk)
+{
+  struct extent_status *ptr = NULL;
+  uint32_t max;
+
+  if (pblk >= walk->blocks_count || lblk > UINT32_MAX) {
+    return -1;
+  }
+
+  ptr = walk->es_num > 0 ? &walk->es[walk->es_num - 1] : NULL;
+  if (ptr
+      && (uint64_t)ptr->es_lblk + ptr->es_len == lblk
+      && ptr->es_pblk + ptr->es_len == pblk
+      && ptr->es_len < UINT32_MAX) {
+    ptr->es_len += 1;
+    return 0;
+  }
+
+  if (walk->es_num == walk->es_max) {
+    max = walk->es_max ? walk->es_max << 1 : EXT4_N_BLOCKS;
+    ptr = (struct extent_status *)realloc((void *)walk->es, max * sizeof(struct extent_status));
+    if (!ptr) {
+      return -1;
+    }
+
+    walk->es = ptr;
+    walk->es_max = max;
+  }
+
+  ptr = &walk->es[walk->es_num];
+  ptr->es_lblk = (uint32_t)lblk;
+  ptr->es_len = 1;
+  ptr->es_pblk = pblk;
+  ptr->es_unwritten = 0;
+  walk->es_num += 1;
+
+  return 0;
+}
+
+/*
+ * Get indirect block of pblk at level of depth, mapped in place
+ * or read into buffer of the level, allocated on demand
+ */
+static const uint32_t* ext4_ind_block(struct ext4_ind_walk *walk, uint64_t pblk, int32_t depth)
+{
+  struct super_block *sb = walk->inode->i_sb;
+  const uint8_t *block = NULL;
+  uint8_t **blk = &walk->blks[depth - 1];
+  int64_t offset;
+
+  if (pblk == 0 || pblk >= walk->blocks_count) {
+    return NULL;
+  }
+
+  offset = (int64_t)(pblk * sb->s_blocksize);
+
+  block = io_map(sb->s_io, offset, (int64_t)sb->s_blocksize);
+  if (block) {
+    return (const uint32_t *)block;
+  }
+
+  if (!*blk) {
+    *blk = (uint8_t *)malloc(sb->s_blocksize);
+    if (!*blk) {
+      return NULL;
+    }
+  }
+
+  if (io_pread(sb->s_io, offset, *blk, (int64_t)sb->s_blocksize) != (int64_t)sb->s_blocksize) {
+    return NULL;
+  }
+
+  return (const uint32_t *)*blk;
+}
+
+/*
+ * Map blocks under indirect block of pblk at level of depth, starting at lblk,
+ * with 1 for indirect block pointing to data blocks,
+ * and blocks of 0 skipped as holes with all blocks under them
+ */
+static int32_t ext4_ind_map_block(struct ext4_ind_walk *walk, uint64_t pblk, int32_t depth, uint64_t lblk)
+{
+  const uint32_t *block = NULL;
+  uint64_t addrs, span, child;
+  uint32_t i;
+  int32_t d;
+
+  block = ext4_ind_block(walk, pblk, depth);
+  if (!block) {
+    return -1;
+  }
+
+  addrs = walk->inode->i_sb->s_blocksize / sizeof(uint32_t);
+  for (d = 1, span = 1; d < depth; ++d) {
+    span *= addrs;
+  }
+
+  for (i = 0; i < addrs && lblk < walk->lblks; ++i, lblk += span) {
+    child = (uint64_t)block[i];
+    if (child == 0) {
+      continue;
+    }
+
+    if (depth == 1) {
+      if (ext4_ind_add(walk, lblk, child) != 0) {
+        return -1;
+      }
+    } else {
+      if (ext4_ind_map_block(walk, child, depth - 1, lblk) != 0) {
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Map blocks of inode of Ext2/Ext3 into runs of blocks contiguous both
+ * logically and physically, sorted by logical block, by walking direct blocks
+ * and indirect, double-indirect and triple-indirect blocks in i_block,
+ * refer to 'ext4_ind_map_blocks' in kernel/fs/ext4/indirect.c
+ */
+int32_t ext4_ind_map(struct inode *inode, struct extent_status **es, uint32_t *es_num)
+{
+  struct super_block *sb = inode->i_sb;
+  struct ext4_super_block *sbs = ((struct ext4_sb_info *)(sb->s_fs_info))->s_es;
+  struct ext4_ind_walk walk;
+  struct extent_status *ptr = NULL;
+  uint64_t lblk, span, addrs;
+  int32_t depth, i;
+  int32_t ret;
+
+  *es = NULL;
+  *es_num = 0;
+
+  memset((void *)&walk, 0, sizeof(struct ext4_ind_walk));
+  walk.inode = inode;
+  walk.blocks_count = ((uint64_t)sbs->s_blocks_count_hi << 32) | (uint64_t)sbs->s_blocks_count_lo;
+  walk.lblks = ((uint64_t)inode->i_size + sb->s_blocksize - 1) / sb->s_blocksize;
+
+  ret = 0;
+
+  for (i = 0; i < EXT4_NDIR_BLOCKS && (uint64_t)i < walk.lblks; ++i) {
+    if (inode->i_block[i] != 0) {
+      ret = ext4_ind_add(&walk, (uint64_t)i, (uint64_t)inode->i_block[i]);
+      if (ret != 0) {
+        goto ext4_ind_map_exit;
+      }
+    }
+  }
+
+  addrs = sb->s_blocksize / sizeof(uint32_t);
+  lblk = EXT4_NDIR_BLOCKS;
+  span = 1;
+
+  for (depth = 1; depth <= EXT4_IND_DEPTH_MAX && lblk < walk.lblks; ++depth) {
+    span *= addrs;
+
+    if (inode->i_block[EXT4_IND_BLOCK + depth - 1] != 0) {
+      ret = ext4_ind_map_block(&walk, (uint64_t)inode->i_block[EXT4_IND_BLOCK + depth - 1], depth, lblk);
+      if (ret != 0) {
+        goto ext4_ind_map_exit;
+      }
+    }
+
+    lblk += span;
+  }
+
+  /*
+   * Trim map to runs in it, as it is kept along with inode
+   */
+  if (walk.es_num > 0 && walk.es_num < walk.es_max) {
+    ptr = (struct extent_status *)realloc((void *)walk.es, walk.es_num * sizeof(struct extent_status));
+    if (ptr) {
+      walk.es = ptr;
+    }
+  }
+
+  *es = walk.es;
+  *es_num = walk.es_num;
+  walk.es = NULL;
+
+ ext4_ind_map_exit:
+
+  for (depth = 0; depth < EXT4_IND_DEPTH_MAX; ++depth) {
+    if (walk.blks[depth]) {
+      free((void *)walk.blks[depth]);
+      walk.blks[depth] = NULL;
+    }
+  }
+
+  if (walk.es) {
+    free((void *)walk.es);
+    walk.es = NULL;
+  }
+
+  return ret != 0 ? -1 : 0;
+}
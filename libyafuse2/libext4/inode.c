@@ -90,27 +90,24 @@ int32_t ext4_raw_inode(struct super_block *sb, uint64_t ino, struct ext4_inode *
   ext4_group_t bg;
   int32_t inodes_per_block, inode_offset;
   int64_t start, offset;
-  int32_t ret;
 
   if (!ext4_valid_inum(sb, ino)) {
     return -1;
   }
 
   bg = (ext4_group_t)((ino - 1) / info->s_inodes_per_group);
-  gdp = &info->s_group_desc[bg];
+  /*
+   * Descriptors are packed by size of descriptor of filesystem, e.g., 32 bytes
+   * without 64bit feature for Ext2/Ext3, rather than size of type of it
+   */
+  gdp = (struct ext4_group_desc *)((uint8_t *)info->s_group_desc + (uint64_t)bg * info->s_desc_size);
 
   inodes_per_block = (int32_t)info->s_inodes_per_block;
   inode_offset = (int32_t)((ino - 1) % info->s_inodes_per_group);
 
   start = (int64_t)((ext4_inode_table(sb, gdp) + (inode_offset / inodes_per_block)) * sb->s_blocksize);
   offset = (int64_t)((inode_offset % inodes_per_block) * es->s_inode_size);
-  ret = io_seek(start + offset);
-  if (ret != 0) {
-    return -1;
-  }
-
-  ret = io_read((uint8_t *)inode, sizeof(struct ext4_inode));
-  if (ret != 0) {
+  if (io_pread(sb->s_io, start + offset, (uint8_t *)inode, (int64_t)sizeof(struct ext4_inode)) != (int64_t)sizeof(struct ext4_inode)) {
     return -1;
   }
 
@@ -122,3 +119,27 @@ int32_t ext4_raw_inode(struct super_block *sb, uint64_t ino, struct ext4_inode *
 
   return 0;
 }
+
+/*
+ * Map blocks of inode into extents sorted by logical block, by extent tree
+ * for inode with extent flag, or by indirect blocks for inode of Ext2/Ext3 without it,
+ * since direct block in i_block may look like header of extent tree,
+ * refer to 'ext4_map_blocks' in kernel/fs/ext4/inode.c
+ */
+int32_t ext4_map_blocks(struct inode *inode, struct extent_status **es, uint32_t *es_num)
+{
+  if (inode->i_flags & EXT4_EXTENTS_FL) {
+    return ext4_ext_map(inode, es, es_num);
+  }
+
+  /*
+   * Data inline in i_block
+   */
+  if (inode->i_flags & EXT4_INLINE_DATA_FL) {
+    *es = NULL;
+    *es_num = 0;
+    return -1;
+  }
+
+  return ext4_ind_map(inode, es, es_num);
+}
@@ -38,6 +38,15 @@
 /*
  * Macro Definition
  */
+/*
+ * Max levels of hash tree, with large directory, refer to kernel/fs/ext4/ext4.h
+ */
+#define EXT4_HTREE_LEVEL  (3)
+
+/*
+ * Mask of logical block in index entry
+ */
+#define EXT4_DX_BLOCK_MASK  (0x0fffffff)
 
 /*
  * Type Definition
@@ -53,6 +62,12 @@ struct fake_dirent
   u8 file_type;
 };
 
+struct dx_countlimit
+{
+  __le16 limit;
+  __le16 count;
+};
+
 struct dx_entry
 {
   __le32 hash;
@@ -89,7 +104,180 @@ struct dx_node
 /*
  * Function Declaration
  */
+static int32_t ext4_dx_count(struct inode *inode, const uint8_t *block, const struct dx_entry *entries, uint32_t *count);
+static const struct dx_entry* ext4_dx_search(const struct dx_entry *entries, uint32_t count, uint32_t hash);
 
 /*
  * Function Definition
  */
+/*
+ * Get count of index entries, with limit of them checked within block
+ */
+static int32_t ext4_dx_count(struct inode *inode, const uint8_t *block, const struct dx_entry *entries, uint32_t *count)
+{
+  const struct dx_countlimit *cl = (const struct dx_countlimit *)entries;
+
+  if (cl->count == 0 || cl->count > cl->limit
+      || (const uint8_t *)(entries + cl->limit) > block + inode->i_sb->s_blocksize) {
+    return -1;
+  }
+
+  *count = (uint32_t)cl->count;
+
+  return 0;
+}
+
+/*
+ * Get index entry covering hash by binary search, with the first one
+ * holding count & limit instead of hash, and covering hash below the second one
+ */
+static const struct dx_entry* ext4_dx_search(const struct dx_entry *entries, uint32_t count, uint32_t hash)
+{
+  const struct dx_entry *p = entries + 1, *q = entries + count - 1, *m = NULL;
+
+  while (p <= q) {
+    m = p + (q - p) / 2;
+
+    if (m->hash > hash) {
+      q = m - 1;
+    } else {
+      p = m + 1;
+    }
+  }
+
+  return p - 1;
+}
+
+/*
+ * Find dentry matched with name in directory of inode by hash tree index,
+ * with root and index blocks walked down to the leaf block covering hash of name,
+ * and following leaf blocks searched only if hash continues in them by collision
+ *
+ * return 1 if not found, or -1 if directory is not indexed or index is not usable,
+ * and then directory is searched linearly instead by caller
+ */
+int32_t ext4_dx_find_dentry(struct inode *inode, const char *name, uint32_t len, struct ext4_dir_entry_2 *dentry)
+{
+  struct super_block *sb = inode->i_sb;
+  struct ext4_super_block *es = ((struct ext4_sb_info *)(sb->s_fs_info))->s_es;
+  struct dx_hash_info hinfo;
+  const struct dx_root *root = NULL;
+  const struct dx_entry *entries = NULL, *at = NULL;
+  const uint8_t *block = NULL, *leaf = NULL;
+  uint8_t *data = NULL, *leaf_data = NULL;
+  uint32_t count, levels, level, next, up_next;
+  uint64_t blk;
+  bool bounded, up_bounded, in_node;
+  int32_t ret;
+
+  if (!is_dx(inode) || len == 0 || len > EXT4_NAME_LEN) {
+    return -1;
+  }
+
+  ret = -1;
+
+  /*
+   * Check root of index in the first block, following '.' and '..'
+   */
+  if (ext4_raw_dir_block(inode, 0, &data, &block) != 0 || !block) {
+    goto ext4_dx_find_dentry_exit;
+  }
+
+  root = (const struct dx_root *)block;
+  if (root->info.reserved_zero != 0
+      || (root->info.unused_flags & 1)
+      || root->info.info_length < sizeof(struct dx_root_info)
+      || root->info.indirect_levels >= EXT4_HTREE_LEVEL
+      || root->info.hash_version > DX_HASH_TEA) {
+    goto ext4_dx_find_dentry_exit;
+  }
+
+  memset((void *)&hinfo, 0, sizeof(struct dx_hash_info));
+  hinfo.hash_version = (int)root->info.hash_version;
+  if (es->s_flags & EXT2_FLAGS_UNSIGNED_HASH) {
+    hinfo.hash_version += DX_HASH_LEGACY_UNSIGNED;
+  }
+  hinfo.seed = (u32 *)es->s_hash_seed;
+
+  if (ext4fs_dirhash(name, (int32_t)len, &hinfo) != 0) {
+    goto ext4_dx_find_dentry_exit;
+  }
+
+  /*
+   * Walk down index blocks, with hash of entry following path in levels above kept
+   */
+  entries = (const struct dx_entry *)((const uint8_t *)&root->info + root->info.info_length);
+  levels = (uint32_t)root->info.indirect_levels;
+  up_next = 0;
+  up_bounded = 0;
+
+  for (level = 0; ; ++level) {
+    if (ext4_dx_count(inode, block, entries, &count) != 0) {
+      goto ext4_dx_find_dentry_exit;
+    }
+
+    at = ext4_dx_search(entries, count, hinfo.hash);
+    blk = (uint64_t)(at->block & EXT4_DX_BLOCK_MASK);
+    if (level == levels) {
+      break;
+    }
+
+    if (at + 1 < entries + count) {
+      up_next = (at + 1)->hash;
+      up_bounded = 1;
+    }
+
+    if (ext4_raw_dir_block(inode, blk, &data, &block) != 0 || !block) {
+      goto ext4_dx_find_dentry_exit;
+    }
+
+    entries = ((const struct dx_node *)block)->entries;
+  }
+
+  /*
+   * Search leaf block, and the following ones while hash continues in them,
+   * which are looked up linearly instead if they are under another index block
+   */
+  while (1) {
+    in_node = at + 1 < entries + count ? 1 : 0;
+    next = in_node ? (at + 1)->hash : up_next;
+    bounded = in_node || up_bounded ? 1 : 0;
+
+    if (ext4_raw_dir_block(inode, blk, &leaf_data, &leaf) != 0 || !leaf) {
+      ret = -1;
+      break;
+    }
+
+    ret = ext4_find_dentry_block(inode, leaf, name, len, dentry);
+    if (ret <= 0) {
+      break;
+    }
+
+    if (!bounded || !(next & 1) || (next & ~1) != hinfo.hash) {
+      ret = 1;
+      break;
+    }
+
+    if (!in_node) {
+      ret = -1;
+      break;
+    }
+
+    at += 1;
+    blk = (uint64_t)(at->block & EXT4_DX_BLOCK_MASK);
+  }
+
+ ext4_dx_find_dentry_exit:
+
+  if (data) {
+    free((void *)data);
+    data = NULL;
+  }
+
+  if (leaf_data) {
+    free((void *)leaf_data);
+    leaf_data = NULL;
+  }
+
+  return ret;
+}
@@ -120,36 +120,30 @@ int32_t ext4_fill_super_info(struct super_block *sb, struct ext4_super_block *es
   return ret;
 }
 
-int32_t ext4_raw_super(struct ext4_super_block *sb)
+int32_t ext4_raw_super(struct super_block *sb, struct ext4_super_block *es)
 {
   int64_t offset = 0;
   int64_t sb_sz = 0;
-  int32_t ret = 0;
 
   offset = EXT4_GROUP_0_PAD_SZ;
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
 
   /*
    * Fill in Ext4 superblock
    * default size of superblock is 1024 bytes
    */
   sb_sz = sizeof(struct ext4_super_block);
-  ret = io_read((uint8_t *)sb, sb_sz);
-  if (ret != 0) {
-    memset((void *)sb, 0, (size_t)sb_sz);
+  if (io_pread(sb->s_io, offset, (uint8_t *)es, sb_sz) != sb_sz) {
+    memset((void *)es, 0, (size_t)sb_sz);
     return -1;
   }
 
-  if (sb->s_magic != EXT4_SUPER_MAGIC) {
+  if (es->s_magic != EXT4_SUPER_MAGIC) {
     return -1;
   }
 
 #ifdef DEBUG_LIBEXT4_SUPER
   memset((void *)buf, 0, sizeof(buf));
-  ext4_show_stat_sb(sb, buf, sizeof(buf));
+  ext4_show_stat_sb(es, buf, sizeof(buf));
   fprintf(stdout, "%s", buf);
 #endif
 
@@ -95,7 +95,7 @@ int32_t fat_fill_dent_start(const struct fat_super_block *sb, const struct msdos
   return 0;
 }
 
-int32_t fat_fill_root_dentries(const struct fat_super_block *sb, int32_t *dentries)
+int32_t fat_fill_root_dentries(struct io_ctx *ctx, const struct fat_super_block *sb, int32_t *dentries)
 {
   int32_t root_den_sec = 0;
   int64_t offset = 0;
@@ -110,43 +110,39 @@ int32_t fat_fill_root_dentries(const struct fat_super_block *sb, int32_t *dentri
   }
 
   offset = root_den_sec * (int32_t)GET_UNALIGNED_LE16(sb->bs.sector_size);
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
 
   sz = sizeof(struct msdos_dir_entry);
-  ret = io_read((uint8_t *)&dentry, sz);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
     return -1;
   }
+  offset += sz;
 
   /*
    * Long File Names (LFN), i.e., dslot, is used
    */
   if (dentry.attr == ATTR_EXT) {
-    ret = io_read((uint8_t *)&dentry, sz);
-    if (ret != 0) {
+    if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
       return -1;
     }
+    offset += sz;
   }
 
   while (dentry.name[0] != '\0') {
     ++i;
 
-    ret = io_read((uint8_t *)&dentry, sz);
-    if (ret != 0) {
+    if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
       return -1;
     }
+    offset += sz;
 
     /*
      * Long File Names (LFN), i.e., dslot, is used
      */
     if (dentry.name[0] != '\0' && dentry.attr == ATTR_EXT) {
-      ret = io_read((uint8_t *)&dentry, sz);
-      if (ret != 0) {
+      if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
         return -1;
       }
+      offset += sz;
     }
   }
 
@@ -155,7 +151,7 @@ int32_t fat_fill_root_dentries(const struct fat_super_block *sb, int32_t *dentri
   return 0;
 }
 
-int32_t fat_fill_root_dentry(const struct fat_super_block *sb, int32_t dentries, struct msdos_dir_slot *dslot, struct msdos_dir_entry *dentry)
+int32_t fat_fill_root_dentry(struct io_ctx *ctx, const struct fat_super_block *sb, int32_t dentries, struct msdos_dir_slot *dslot, struct msdos_dir_entry *dentry)
 {
   int32_t root_den_sec = 0;
   int64_t offset = 0;
@@ -169,27 +165,25 @@ int32_t fat_fill_root_dentry(const struct fat_super_block *sb, int32_t dentries,
   }
 
   offset = root_den_sec * (int32_t)GET_UNALIGNED_LE16(sb->bs.sector_size);
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
 
   sz = sizeof(struct msdos_dir_entry);
 
   for (i = 0; i < dentries; ++i) {
-    ret = io_read((uint8_t *)&dslot[i], sz);
-    if (ret != 0) {
+    if (io_pread(ctx, offset, (uint8_t *)&dslot[i], sz) != sz) {
+      ret = -1;
       break;
     }
+    offset += sz;
 
     /*
      * Long File Names (LFN), i.e., dslot, is used
      */
     if (dslot[i].attr == ATTR_EXT) {
-      ret = io_read((uint8_t *)&dentry[i], sz);
-      if (ret != 0) {
+      if (io_pread(ctx, offset, (uint8_t *)&dentry[i], sz) != sz) {
+        ret = -1;
         break;
       }
+      offset += sz;
     } else {
       memcpy((void *)&dentry[i], (const void *)&dslot[i], (size_t)sz);
     }
@@ -198,7 +192,7 @@ int32_t fat_fill_root_dentry(const struct fat_super_block *sb, int32_t dentries,
   return ret;
 }
 
-int32_t fat_fill_dentries(const struct fat_super_block *sb, int32_t cluster, int32_t *dentries)
+int32_t fat_fill_dentries(struct io_ctx *ctx, const struct fat_super_block *sb, int32_t cluster, int32_t *dentries)
 {
   int32_t sector = 0;
   int64_t offset = 0;
@@ -213,44 +207,40 @@ int32_t fat_fill_dentries(const struct fat_super_block *sb, int32_t cluster, int
   }
 
   offset = sector * (int32_t)GET_UNALIGNED_LE16(sb->bs.sector_size);
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
 
   /*
    * Read FAT dentry of '.'
    */
   sz = sizeof(struct msdos_dir_entry);
-  ret = io_read((uint8_t *)&dentry, sz);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
     return -1;
   }
+  offset += sz;
 
   /*
    * Read FAT dentry of '..'
    */
-  ret = io_read((uint8_t *)&dentry, sz);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
     return -1;
   }
+  offset += sz;
 
   while (dentry.name[0] != '\0') {
     ++i;
 
-    ret = io_read((uint8_t *)&dentry, sz);
-    if (ret != 0) {
+    if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
       return -1;
     }
+    offset += sz;
 
     /*
      * Long File Names (LFN), i.e., dslot, is used
      */
     if (dentry.attr == ATTR_EXT) {
-      ret = io_read((uint8_t *)&dentry, sz);
-      if (ret != 0) {
+      if (io_pread(ctx, offset, (uint8_t *)&dentry, sz) != sz) {
         return -1;
       }
+      offset += sz;
     }
   }
 
@@ -259,7 +249,7 @@ int32_t fat_fill_dentries(const struct fat_super_block *sb, int32_t cluster, int
   return 0;
 }
 
-int32_t fat_fill_dentry(const struct fat_super_block *sb, int32_t cluster, int32_t dentries, struct msdos_dir_slot *dslot, struct msdos_dir_entry *dentry)
+int32_t fat_fill_dentry(struct io_ctx *ctx, const struct fat_super_block *sb, int32_t cluster, int32_t dentries, struct msdos_dir_slot *dslot, struct msdos_dir_entry *dentry)
 {
   int32_t sector = 0;
   int64_t offset = 0;
@@ -273,10 +263,6 @@ int32_t fat_fill_dentry(const struct fat_super_block *sb, int32_t cluster, int32
   }
 
   offset = sector * (int32_t)GET_UNALIGNED_LE16(sb->bs.sector_size);
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
 
   /*
    * Fill in dentry of '.'
@@ -284,38 +270,40 @@ int32_t fat_fill_dentry(const struct fat_super_block *sb, int32_t cluster, int32
   sz = sizeof(struct msdos_dir_entry);
   memset((void *)&dslot[0], 0, (size_t)sz);
 
-  ret = io_read((uint8_t *)&dentry[0], sz);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, (uint8_t *)&dentry[0], sz) != sz) {
     return -1;
   }
+  offset += sz;
 
   /*
    * Fill in dentry of '..'
    */
   memset((void *)&dslot[1], 0, (size_t)sz);
 
-  ret = io_read((uint8_t *)&dentry[1], sz);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, (uint8_t *)&dentry[1], sz) != sz) {
     return -1;
   }
+  offset += sz;
 
   /*
    * Fill in other dentry
    */
   for (i = 2; i < dentries; ++i) {
-    ret = io_read((uint8_t *)&dslot[i], sz);
-    if (ret != 0) {
+    if (io_pread(ctx, offset, (uint8_t *)&dslot[i], sz) != sz) {
+      ret = -1;
       break;
     }
+    offset += sz;
 
     /*
      * Long File Names (LFN), i.e., dslot, is used
      */
     if (dslot[i].attr == ATTR_EXT) {
-      ret = io_read((uint8_t *)&dentry[i], sz);
-      if (ret != 0) {
+      if (io_pread(ctx, offset, (uint8_t *)&dentry[i], sz) != sz) {
+        ret = -1;
         break;
       }
+      offset += sz;
     } else {
       memcpy((void *)&dentry[i], (const void *)&dslot[i], (size_t)sz);
     }
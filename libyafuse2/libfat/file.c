@@ -54,7 +54,7 @@
 /*
  * Function Definition
  */
-int32_t fat_fill_file(const struct fat_super_block *sb, int32_t cluster, int64_t size, uint8_t *buf)
+int32_t fat_fill_file(struct io_ctx *ctx, const struct fat_super_block *sb, int32_t cluster, int64_t size, uint8_t *buf)
 {
   int32_t sector = 0;
   int64_t offset = 0;
@@ -66,13 +66,7 @@ int32_t fat_fill_file(const struct fat_super_block *sb, int32_t cluster, int64_t
   }
 
   offset = sector * (int32_t)GET_UNALIGNED_LE16(sb->bs.sector_size);
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
-
-  ret = io_read(buf, size);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, buf, size) != size) {
     return -1;
   }
 
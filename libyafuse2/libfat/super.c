@@ -76,7 +76,7 @@ static int32_t fat_is_valid_media(uint32_t media)
   return (media >= 0xF8) || (media == 0xF0);
 }
 
-int32_t fat_fill_sb(struct fat_super_block *sb)
+int32_t fat_fill_sb(struct io_ctx *ctx, struct fat_super_block *sb)
 {
   int64_t offset = 0;
   int64_t sz = 0;
@@ -87,14 +87,8 @@ int32_t fat_fill_sb(struct fat_super_block *sb)
    * Fill in FAT boot sector
    */
   offset = 0;
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
-
   sz = sizeof(struct fat_boot_sector);
-  ret = io_read((uint8_t *)&sb->bs, sz);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, (uint8_t *)&sb->bs, sz) != sz) {
     memset((void *)&sb->bs, 0, (size_t)sz);
     return -1;
   }
@@ -121,14 +115,8 @@ int32_t fat_fill_sb(struct fat_super_block *sb)
     offset = FAT16_BSX_OFFSET;
   }
 
-  ret = io_seek(offset);
-  if (ret != 0) {
-    return -1;
-  }
-
   sz = sizeof(struct fat_boot_bsx);
-  ret = io_read((uint8_t *)&sb->bb, sz);
-  if (ret != 0) {
+  if (io_pread(ctx, offset, (uint8_t *)&sb->bb, sz) != sz) {
     memset((void *)&sb->bb, 0, (size_t)sz);
     return -1;
   }
@@ -138,14 +126,8 @@ int32_t fat_fill_sb(struct fat_super_block *sb)
      * Fill in FAT32 boot fsinfo
      */
     offset = sb->bs.info_sector == 0 ? GET_UNALIGNED_LE16(sb->bs.sector_size) : sb->bs.info_sector * GET_UNALIGNED_LE16(sb->bs.sector_size);
-    ret = io_seek(offset);
-    if (ret != 0) {
-      return -1;
-    }
-
     sz = sizeof(struct fat_boot_fsinfo);
-    ret = io_read((uint8_t *)&sb->bf, sz);
-    if (ret != 0) {
+    if (io_pread(ctx, offset, (uint8_t *)&sb->bf, sz) != sz) {
       memset((void *)&sb->bf, 0,(size_t)sz);
       return -1;
     }
@@ -31,6 +31,8 @@
 #endif
 
 #include "include/base/debug.h"
+#include "include/base/lock.h"
+#include "include/libio/io.h"
 #include "include/fs.h"
 #include "include/libfs/libfs.h"
 
@@ -39,6 +41,11 @@
  */
 #define FS_LIB_NAME_LEN_MAX 16
 
+/*
+ * Max depth of directory connected to tree through '..'
+ */
+#define FS_CONNECT_DEPTH_MAX 2048
+
 /*
  * Type Definition
  */
@@ -47,6 +54,18 @@ struct fs_type_list_t {
   fs_file_system_type_init_t handle;
 };
 
+/*
+ * Session of image mounted, holding all state of it
+ *
+ * Tree of dentry and inodes are looked up with read lock held,
+ * and child dentries are instantiated with write lock held
+ */
+struct fs_session {
+  struct file_system_type *se_type;
+  struct mount se_mnt;
+  struct rwlock se_lock;
+};
+
 /*
  * Global Variable Definition
  */
@@ -57,28 +76,43 @@ static struct fs_type_list_t fs_type_list[] = {
   },
 };
 
-static struct file_system_type *fs_type = NULL;
-static struct mount fs_mnt;
-
 /*
  * Function Declaration
  */
 static int32_t fs_imode2ftype(enum libfs_imode imode, enum libfs_ftype *ftype);
 static int32_t fs_dentry2dirent(struct dentry *dentry, struct fs_dirent *dirent);
-static int32_t fs_traverse_dentry(struct dentry **dentry);
-static int32_t fs_get_dentry(struct dentry *dentry, uint64_t ino, struct dentry **match);
-static int32_t fs_get_inode(struct super_block *sb, uint64_t ino, struct inode *inode);
+static bool fs_dentry_traversed(struct dentry *dentry, uint32_t num);
+static struct dentry* fs_inode_parent(struct inode *inode);
+static void fs_touch_dentry(struct dentry *dentry);
+static void fs_touch_inode(struct inode *inode);
+static void fs_prune(struct super_block *sb, struct dentry *dentry, struct inode *inode);
+static int32_t fs_traverse_dentry(struct dentry **dentry, uint32_t num);
+static int32_t fs_get_dentry(struct super_block *sb, uint64_t ino, struct dentry **match);
+static int32_t fs_connect_dentry(struct super_block *sb, uint64_t ino, uint32_t depth, struct dentry **match);
+static int32_t fs_get_dentry_traversed(struct fs_session *session, uint64_t ino, uint32_t num, struct dentry **match);
+static struct inode* fs_get_inode(struct super_block *sb, uint64_t ino);
+static int32_t fs_get_inode_read(struct fs_session *session, uint64_t ino, struct inode **match);
+static int32_t fs_get_inode_mapped(struct fs_session *session, uint64_t ino, struct inode **match);
+static bool fs_childs_read(struct super_block *sb, struct dentry *parent, uint64_t cursor, uint32_t count, bool read);
 static int32_t fs_stat_helper(struct super_block *sb, struct inode *inode, struct fs_kstat *stat);
-
-static int32_t fs_mount(const char *devname, const char *dirname, const char *type, int32_t flags, struct fs_dirent *dirent);
-static int32_t fs_umount(const char *dirname, int32_t flags);
-static int32_t fs_statfs(const char *pathname, struct fs_kstatfs *buf);
-static int32_t fs_statrawfs(const char *pathname, const char **buf);
-static int32_t fs_stat(uint64_t ino, struct fs_kstat *buf);
-static int32_t fs_statraw(uint64_t ino, const char **buf);
-static int32_t fs_querydent(uint64_t ino, struct fs_dirent *dirent);
-static int32_t fs_getdents(uint64_t ino, struct fs_dirent *dirents, uint32_t count);
-static int32_t fs_readfile(uint64_t ino, int64_t offset, char *buf, int64_t count, int64_t *num);
+static int32_t fs_readdir_helper(struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_dirent *dirents, struct fs_direntplus *entries, uint32_t count, uint32_t *num);
+static int32_t fs_lookup_indexed(struct fs_session *session, uint64_t ino, const char *name, uint32_t len, struct dentry **match);
+static int32_t fs_lookup_helper(struct fs_session *session, uint64_t ino, const char *name, uint32_t len, struct dentry **match);
+
+static int32_t fs_mount(const char *devname, const char *dirname, const char *type, int32_t flags, struct fs_dirent *dirent, struct fs_session **session);
+static int32_t fs_umount(struct fs_session *session, const char *dirname, int32_t flags);
+static int32_t fs_statfs(struct fs_session *session, const char *pathname, struct fs_kstatfs *buf);
+static int32_t fs_statrawfs(struct fs_session *session, const char *pathname, const char **buf);
+static int32_t fs_stat(struct fs_session *session, uint64_t ino, struct fs_kstat *buf);
+static int32_t fs_statraw(struct fs_session *session, uint64_t ino, const char **buf);
+static int32_t fs_querydent(struct fs_session *session, uint64_t ino, struct fs_dirent *dirent);
+static int32_t fs_getdents(struct fs_session *session, uint64_t ino, struct fs_dirent *dirents, uint32_t count);
+static int32_t fs_readfile(struct fs_session *session, uint64_t ino, int64_t offset, char *buf, int64_t count, int64_t *num);
+static int32_t fs_iostats(struct fs_session *session, const char *pathname, struct fs_iostats *buf);
+static int32_t fs_readdirplus(struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_direntplus *entries, uint32_t count, uint32_t *num);
+static int32_t fs_readdir(struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_dirent *dirents, uint32_t count, uint32_t *num);
+static int32_t fs_lookup(struct fs_session *session, uint64_t ino, const char *name, struct fs_dirent *dirent);
+static int32_t fs_resolve(struct fs_session *session, const char *pathname, struct fs_dirent *dirent);
 
 /*
  * Function Definition
@@ -138,88 +172,332 @@ static int32_t fs_dentry2dirent(struct dentry *dentry, struct fs_dirent *dirent)
 }
 
 /*
- * Traverse dentry for chlid dentries
+ * Check if dentry is not directory, or num of its child dentries
+ * or all of them are traversed
+ */
+static bool fs_dentry_traversed(struct dentry *dentry, uint32_t num)
+{
+  return (dentry->d_inode->i_mode & 0xF000) != IFDIR || dentry->d_complete || dentry->d_childnum >= num ? 1 : 0;
+}
+
+/*
+ * Get parent of the first dentry of inode, or NULL if inode has no dentry
  */
-static int32_t fs_traverse_dentry(struct dentry **dentry)
+static struct dentry* fs_inode_parent(struct inode *inode)
 {
-  struct super_block *sb = fs_mnt.mnt.mnt_sb;
-  struct inode *inode = (*dentry)->d_inode;
+  if (list_empty(&inode->i_dentry)) {
+    return NULL;
+  }
+
+  return list_entry(inode->i_dentry.next, struct dentry, d_alias)->d_parent;
+}
+
+/*
+ * Mark directory of dentry accessed, for LRU list of directories,
+ * with read lock of session held at least
+ */
+static void fs_touch_dentry(struct dentry *dentry)
+{
+  if (!atomic_load32(&dentry->d_referenced)) {
+    atomic_store32(&dentry->d_referenced, 1);
+  }
+}
+
+/*
+ * Mark inode accessed, by directory of dentry of it,
+ * or by itself in LRU list of inodes if it has no dentry
+ */
+static void fs_touch_inode(struct inode *inode)
+{
+  struct dentry *parent = fs_inode_parent(inode);
+
+  if (parent) {
+    fs_touch_dentry(parent);
+  } else if (!atomic_load32(&inode->i_referenced)) {
+    atomic_store32(&inode->i_referenced, 1);
+  }
+}
+
+/*
+ * Evict dentries and inodes to keep memory of them within budget,
+ * except for dentry and inode in use, called with write lock held
+ */
+static void fs_prune(struct super_block *sb, struct dentry *dentry, struct inode *inode)
+{
+  if (!sb->s_op || !sb->s_op->prune) {
+    return;
+  }
+
+  /*
+   * Directory traversed last is pinned if no other one is, e.g., for inode
+   * read without dentry, lest it is evicted before traversal is taken
+   * by thread, and traversed again and again with budget exceeded by it
+   */
+  if (!dentry && sb->s_traversed != 0) {
+    (void)fs_get_dentry(sb, sb->s_traversed, &dentry);
+  }
+
+  (void)sb->s_op->prune(sb, dentry, inode);
+}
+
+/*
+ * Traverse dentry for num of chlid dentries at least
+ */
+static int32_t fs_traverse_dentry(struct dentry **dentry, uint32_t num)
+{
+  struct super_block *sb = (*dentry)->d_sb;
   int32_t ret;
 
   if (!sb || !sb->s_op || !sb->s_op->traverse_dentry) {
     return -1;
   }
 
-  if (!((inode->i_mode & 0xF000) == IFDIR) || !list_empty(&(*dentry)->d_subdirs)) {
+  if (fs_dentry_traversed(*dentry, num)) {
     return 0;
   }
 
-  ret = sb->s_op->traverse_dentry(dentry);
+  ret = sb->s_op->traverse_dentry(dentry, num);
   if (ret != 0) {
     return -1;
   }
 
+  fs_touch_dentry(*dentry);
+  sb->s_traversed = (uint64_t)(*dentry)->d_inode->i_ino;
+  fs_prune(sb, *dentry, NULL);
+
   return 0;
 }
 
 /*
- * Get dentry from ino of filesystem
+ * Get dentry from ino of filesystem,
+ * the first one instantiated among hard links
  */
-static int32_t fs_get_dentry(struct dentry *dentry, uint64_t ino, struct dentry **match)
+static int32_t fs_get_dentry(struct super_block *sb, uint64_t ino, struct dentry **match)
 {
-  struct dentry *child = NULL;
-  int32_t ret = -1;
+  struct inode *inode = NULL;
 
-  if (dentry->d_inode->i_ino == ino) {
-    *match = dentry;
+  if (!sb) {
+    return -1;
+  }
+
+  inode = fs_get_inode(sb, ino);
+  if (!inode || list_empty(&inode->i_dentry)) {
+    return -1;
+  }
+
+  *match = list_entry(inode->i_dentry.next, struct dentry, d_alias);
+
+  return 0;
+}
+
+/*
+ * Get dentry from ino of directory, and connect it to tree if it is evicted,
+ * by connecting parent of it got from '..', and traversing parent
+ * till it is instantiated, called with write lock of session held
+ */
+static int32_t fs_connect_dentry(struct super_block *sb, uint64_t ino, uint32_t depth, struct dentry **match)
+{
+  struct dentry *parent = NULL;
+  uint64_t parent_ino;
+
+  if (fs_get_dentry(sb, ino, match) == 0) {
     return 0;
   }
 
-  if (!list_empty(&dentry->d_subdirs)) {
-#if 0  // For CMAKE_COMPILER_IS_GNUCC only
-    list_for_each_entry(child, &dentry->d_subdirs, d_child) {
-#else
-    for (child = list_entry((&dentry->d_subdirs)->next, struct dentry, d_child);
-         &child->d_child != (&dentry->d_subdirs);
-         child = list_entry(child->d_child.next, struct dentry, d_child)) {
-#endif
-      ret = fs_get_dentry(child, ino, match);
-      if (ret == 0) {
-        break;
-      }
+  if (depth == 0 || !sb->s_op || !sb->s_op->get_parent) {
+    return -1;
+  }
+
+  if (sb->s_op->get_parent(sb, ino, &parent_ino) != 0 || parent_ino == ino) {
+    return -1;
+  }
+
+  if (fs_connect_dentry(sb, parent_ino, depth - 1, &parent) != 0) {
+    return -1;
+  }
+
+  while (fs_get_dentry(sb, ino, match) != 0) {
+    if (parent->d_complete || parent->d_childnum == UINT32_MAX) {
+      return -1;
+    }
+
+    if (fs_traverse_dentry(&parent, parent->d_childnum + 1) != 0) {
+      return -1;
+    }
+
+    if (fs_get_dentry(sb, parent_ino, &parent) != 0) {
+      return -1;
     }
   }
 
-  return ret;
+  return 0;
+}
+
+/*
+ * Get dentry from ino of filesystem, with num of child dentries traversed
+ * at least, or all of them for UINT32_MAX, called with read lock of session held
+ *
+ * Read lock is upgraded to write lock to connect and traverse dentry,
+ * and dentry is got again after each of them is taken,
+ * since it may be traversed or evicted by another thread meanwhile
+ */
+static int32_t fs_get_dentry_traversed(struct fs_session *session, uint64_t ino, uint32_t num, struct dentry **match)
+{
+  struct super_block *sb = session->se_mnt.mnt.mnt_sb;
+  int32_t ret;
+
+  while (1) {
+    ret = fs_get_dentry(sb, ino, match);
+    if (ret == 0 && fs_dentry_traversed(*match, num)) {
+      fs_touch_dentry(*match);
+      return 0;
+    }
+
+    read_unlock(&session->se_lock);
+    write_lock(&session->se_lock);
+
+    ret = fs_connect_dentry(sb, ino, FS_CONNECT_DEPTH_MAX, match);
+    if (ret == 0) {
+      ret = fs_traverse_dentry(match, num);
+    }
+
+    write_unlock(&session->se_lock);
+    read_lock(&session->se_lock);
+
+    if (ret != 0) {
+      return -1;
+    }
+  }
+
+  return -1;
 }
 
 /*
  * Get inode from ino of filesystem
  */
-static int32_t fs_get_inode(struct super_block *sb, uint64_t ino, struct inode *inode)
+static struct inode* fs_get_inode(struct super_block *sb, uint64_t ino)
 {
-  struct inode *child = NULL;
-  int32_t ret = -1;
+  if (!sb->s_op || !sb->s_op->find_inode) {
+    return NULL;
+  }
 
-  if (list_empty(&sb->s_inodes)) {
+  return sb->s_op->find_inode(sb, ino);
+}
+
+/*
+ * Get inode from ino of filesystem, with it read from disk,
+ * called with read lock of session held
+ *
+ * Read lock is upgraded to write lock to read inode, or instantiate it
+ * without dentry if it is evicted, and inode is got again
+ * after each of them is taken
+ */
+static int32_t fs_get_inode_read(struct fs_session *session, uint64_t ino, struct inode **match)
+{
+  struct super_block *sb = session->se_mnt.mnt.mnt_sb;
+  int32_t ret;
+
+  if (!sb->s_op || !sb->s_op->iget) {
     return -1;
   }
 
-#if 0  // For CMAKE_COMPILER_IS_GNUCC only
-  list_for_each_entry(child, &sb->s_inodes, i_sb_list) {
-#else
-  for (child = list_entry((&sb->s_inodes)->next, struct inode, i_sb_list);
-       &child->i_sb_list != (&sb->s_inodes);
-       child = list_entry(child->i_sb_list.next, struct inode, i_sb_list)) {
-#endif
-    if (child->i_ino == ino) {
-      *inode = *child;
-      ret = 0;
-      break;
+  while (1) {
+    *match = fs_get_inode(sb, ino);
+    if (*match && !(*match)->i_new) {
+      fs_touch_inode(*match);
+      return 0;
+    }
+
+    read_unlock(&session->se_lock);
+    write_lock(&session->se_lock);
+
+    *match = sb->s_op->iget(sb, ino);
+    if (*match) {
+      fs_touch_inode(*match);
+      fs_prune(sb, fs_inode_parent(*match), *match);
+    }
+    ret = *match ? 0 : -1;
+
+    write_unlock(&session->se_lock);
+    read_lock(&session->se_lock);
+
+    if (ret != 0) {
+      return -1;
     }
   }
 
-  return ret;
+  return -1;
+}
+
+/*
+ * Get inode from ino of filesystem, with it read from disk and blocks of it mapped,
+ * called with read lock of session held
+ *
+ * Read lock is upgraded to write lock to map blocks, as map is kept along with inode,
+ * and inode is got again after it is taken
+ */
+static int32_t fs_get_inode_mapped(struct fs_session *session, uint64_t ino, struct inode **match)
+{
+  struct super_block *sb = session->se_mnt.mnt.mnt_sb;
+  int32_t ret;
+
+  while (1) {
+    ret = fs_get_inode_read(session, ino, match);
+    if (ret != 0) {
+      return -1;
+    }
+
+    if ((*match)->i_mapped || !sb->s_op->map_inode) {
+      return 0;
+    }
+
+    read_unlock(&session->se_lock);
+    write_lock(&session->se_lock);
+
+    *match = sb->s_op->iget(sb, ino);
+    ret = *match ? sb->s_op->map_inode(*match) : -1;
+    if (ret == 0) {
+      fs_prune(sb, fs_inode_parent(*match), *match);
+    }
+
+    write_unlock(&session->se_lock);
+    read_lock(&session->se_lock);
+
+    if (ret != 0) {
+      return -1;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Check if inodes of child dentries in page from cursor are all read from disk,
+ * or read ones not read yet if read is set, called with write lock held
+ */
+static bool fs_childs_read(struct super_block *sb, struct dentry *parent, uint64_t cursor, uint32_t count, bool read)
+{
+  struct dentry *child = NULL;
+  uint64_t pos;
+
+  for (child = list_entry((&parent->d_subdirs)->prev, struct dentry, d_child), pos = 0;
+       &child->d_child != (&parent->d_subdirs) && pos < cursor + count;
+       child = list_entry(child->d_child.prev, struct dentry, d_child), ++pos) {
+    if (pos < cursor || !child->d_inode->i_new) {
+      continue;
+    }
+
+    if (!read || !sb->s_op->read_inode) {
+      return 0;
+    }
+
+    /*
+     * Keep on with stats of type of file only, if inode is not read
+     */
+    (void)sb->s_op->read_inode(child->d_inode);
+  }
+
+  return 1;
 }
 
 /*
@@ -261,15 +539,18 @@ static int32_t fs_stat_helper(struct super_block *sb, struct inode *inode, struc
 /*
  * Mount filesystem
  */
-static int32_t fs_mount(const char *devname, const char *dirname, const char *type, int32_t flags, struct fs_dirent *dirent)
+static int32_t fs_mount(const char *devname, const char *dirname, const char *type, int32_t flags, struct fs_dirent *dirent, struct fs_session **session)
 {
   fs_file_system_type_init_t handle = NULL;
+  struct file_system_type *fs_type = NULL;
+  struct fs_session *se = NULL;
   struct dentry *root = NULL;
+  struct mount_data data;
   int32_t i, len;
 
   dirname = dirname;
 
-  if (!type || !dirent || fs_mnt.mnt_count != 0) {
+  if (!type || !dirent || !session) {
     return -1;
   }
 
@@ -291,38 +572,80 @@ static int32_t fs_mount(const char *devname, const char *dirname, const char *ty
     return -1;
   }
 
-  root = fs_type->mount(fs_type, flags, devname, NULL);
+  memset((void *)&data, 0, sizeof(struct mount_data));
+  data.md_nocache = (flags & FS_MNT_NOCACHE) ? 1 : 0;
+  data.md_cache_blks = ((uint32_t)flags >> FS_MNT_CACHE_SHIFT) & FS_MNT_CACHE_MASK;
+  data.md_direct = (flags & FS_MNT_DIRECT) ? 1 : 0;
+  data.md_mem_budget = (uint64_t)(((uint32_t)flags >> FS_MNT_MEM_SHIFT) & FS_MNT_MEM_MASK) << 20;
+
+  root = fs_type->mount(fs_type, flags, devname, (void *)&data);
   if (!root) {
     return -1;
   }
 
-  memset((void *)&fs_mnt, 0, sizeof(struct mount));
-  fs_mnt.mnt.mnt_root = root;
-  fs_mnt.mnt.mnt_sb = root->d_sb;
-  fs_mnt.mnt.mnt_flags = flags;
-  fs_mnt.mnt_mountpoint = fs_mnt.mnt.mnt_root;
-  fs_mnt.mnt_count = 1;
-  fs_mnt.mnt_devname = devname;
+  se = (struct fs_session *)malloc(sizeof(struct fs_session));
+  if (!se) {
+    goto fs_mount_fail;
+  }
+  memset((void *)se, 0, sizeof(struct fs_session));
+
+  if (rwlock_init(&se->se_lock) != 0) {
+    free((void *)se);
+    se = NULL;
+    goto fs_mount_fail;
+  }
+
+  se->se_type = fs_type;
+  se->se_mnt.mnt.mnt_root = root;
+  se->se_mnt.mnt.mnt_sb = root->d_sb;
+  se->se_mnt.mnt.mnt_flags = flags;
+  se->se_mnt.mnt_mountpoint = se->se_mnt.mnt.mnt_root;
+  se->se_mnt.mnt_count = 1;
+  se->se_mnt.mnt_devname = devname;
 
   memset((void *)dirent, 0, sizeof(struct fs_dirent));
-  if (fs_dentry2dirent(fs_mnt.mnt_mountpoint, dirent) != 0) {
-    return -1;
+  if (fs_dentry2dirent(se->se_mnt.mnt_mountpoint, dirent) != 0) {
+    goto fs_mount_fail;
   }
 
+  *session = se;
+
   return 0;
+
+ fs_mount_fail:
+
+  if (fs_type->umount) {
+    (void)fs_type->umount(root->d_sb, flags);
+  }
+
+  if (se) {
+    rwlock_destroy(&se->se_lock);
+    free((void *)se);
+    se = NULL;
+  }
+
+  return -1;
 }
 
 /*
- * Unmount filesystem
+ * Unmount filesystem, and free session
  */
-static int32_t fs_umount(const char *dirname, int32_t flags)
+static int32_t fs_umount(struct fs_session *session, const char *dirname, int32_t flags)
 {
-  if (fs_type && fs_type->umount) {
-    (void)fs_type->umount(dirname, flags);
-    fs_type = NULL;
+  dirname = dirname;
+
+  if (!session) {
+    return -1;
+  }
+
+  if (session->se_type && session->se_type->umount) {
+    (void)session->se_type->umount(session->se_mnt.mnt.mnt_sb, flags);
   }
 
-  memset((void *)&fs_mnt, 0, sizeof(struct mount));
+  rwlock_destroy(&session->se_lock);
+
+  memset((void *)session, 0, sizeof(struct fs_session));
+  free((void *)session);
 
   return 0;
 }
@@ -330,10 +653,10 @@ static int32_t fs_umount(const char *dirname, int32_t flags)
 /*
  * Show stats of filesystem
  */
-static int32_t fs_statfs(const char *pathname, struct fs_kstatfs *buf)
+static int32_t fs_statfs(struct fs_session *session, const char *pathname, struct fs_kstatfs *buf)
 {
-  struct super_block *sb = fs_mnt.mnt.mnt_sb;
-  struct dentry *root = fs_mnt.mnt.mnt_root;
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct dentry *root = session ? session->se_mnt.mnt.mnt_root : NULL;
   struct kstatfs rootbuf;
   int32_t ret;
 
@@ -370,10 +693,10 @@ static int32_t fs_statfs(const char *pathname, struct fs_kstatfs *buf)
 /*
  * Show raw stats of filesystem
  */
-static int32_t fs_statrawfs(const char *pathname, const char **buf)
+static int32_t fs_statrawfs(struct fs_session *session, const char *pathname, const char **buf)
 {
-  struct super_block *sb = fs_mnt.mnt.mnt_sb;
-  struct dentry *root = fs_mnt.mnt.mnt_root;
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct dentry *root = session ? session->se_mnt.mnt.mnt_root : NULL;
   int32_t ret;
 
   if (!pathname || !buf) {
@@ -395,11 +718,10 @@ static int32_t fs_statrawfs(const char *pathname, const char **buf)
 /*
  * Show stats of file
  */
-static int32_t fs_stat(uint64_t ino, struct fs_kstat *buf)
+static int32_t fs_stat(struct fs_session *session, uint64_t ino, struct fs_kstat *buf)
 {
-  struct super_block *sb = fs_mnt.mnt.mnt_sb;
-  struct inode inode;
-  int32_t ret;
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct inode *inode = NULL;
 
   if (!buf) {
     return -1;
@@ -409,24 +731,28 @@ static int32_t fs_stat(uint64_t ino, struct fs_kstat *buf)
     return -1;
   }
 
-  memset((void *)&inode, 0, sizeof(struct inode));
-  ret = fs_get_inode(sb, ino, &inode);
-  if (ret != 0) {
-    return -1;
+  read_lock(&session->se_lock);
+
+  if (fs_get_inode_read(session, ino, &inode) != 0) {
+    inode = NULL;
   }
 
-  (void)fs_stat_helper(sb, &inode, buf);
+  if (inode) {
+    (void)fs_stat_helper(sb, inode, buf);
+  }
 
-  return 0;
+  read_unlock(&session->se_lock);
+
+  return inode ? 0 : -1;
 }
 
 /*
  * Show raw stats of file
  */
-static int32_t fs_statraw(uint64_t ino, const char **buf)
+static int32_t fs_statraw(struct fs_session *session, uint64_t ino, const char **buf)
 {
-  struct super_block *sb = fs_mnt.mnt.mnt_sb;
-  struct inode inode;
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct inode *inode = NULL;
   int32_t ret;
 
   if (!buf) {
@@ -437,26 +763,24 @@ static int32_t fs_statraw(uint64_t ino, const char **buf)
     return -1;
   }
 
-  memset((void *)&inode, 0, sizeof(struct inode));
-  ret = fs_get_inode(sb, ino, &inode);
-  if (ret != 0) {
-    return -1;
-  }
+  read_lock(&session->se_lock);
 
-  ret = sb->s_op->statraw(&inode, buf);
-  if (ret != 0) {
-    return -1;
+  ret = fs_get_inode_read(session, ino, &inode);
+  if (ret == 0) {
+    ret = sb->s_op->statraw(inode, buf);
   }
 
-  return 0;
+  read_unlock(&session->se_lock);
+
+  return ret != 0 ? -1 : 0;
 }
 
 /*
  * Query dirent for ino
  */
-static int32_t fs_querydent(uint64_t ino, struct fs_dirent *dirent)
+static int32_t fs_querydent(struct fs_session *session, uint64_t ino, struct fs_dirent *dirent)
 {
-  struct dentry *root = fs_mnt.mnt.mnt_root;
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
   struct dentry *parent = NULL;
   int32_t ret;
 
@@ -464,38 +788,33 @@ static int32_t fs_querydent(uint64_t ino, struct fs_dirent *dirent)
     return -1;
   }
 
-  /*
-   * Get parent dentry mached with ino
-   */
-  ret = fs_get_dentry(root, ino, &parent);
-  if (ret != 0) {
+  if (!sb) {
     return -1;
   }
 
+  read_lock(&session->se_lock);
+
   /*
-   * Check if parent dentry has child dentries and
+   * Get parent dentry mached with ino, and
    * if child dentries exist and not be traversed yet, traverse them now,
    * otherwise just ignore it
    */
-  ret = fs_traverse_dentry(&parent);
-  if (ret != 0) {
-    return -1;
+  ret = fs_get_dentry_traversed(session, ino, UINT32_MAX, &parent);
+  if (ret == 0) {
+    ret = fs_dentry2dirent(parent, dirent);
   }
 
-  ret = fs_dentry2dirent(parent, dirent);
-  if (ret != 0) {
-    return -1;
-  }
+  read_unlock(&session->se_lock);
 
-  return 0;
+  return ret != 0 ? -1 : 0;
 }
 
 /*
  * Get directory entries of filesystem
  */
-static int32_t fs_getdents(uint64_t ino, struct fs_dirent *dirents, uint32_t count)
+static int32_t fs_getdents(struct fs_session *session, uint64_t ino, struct fs_dirent *dirents, uint32_t count)
 {
-  struct dentry *root = fs_mnt.mnt.mnt_root;
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
   struct dentry *parent = NULL, *child = NULL;
   uint32_t i;
   int32_t ret;
@@ -504,22 +823,20 @@ static int32_t fs_getdents(uint64_t ino, struct fs_dirent *dirents, uint32_t cou
     return -1;
   }
 
-  /*
-   * Get parent dentry mached with ino
-   */
-  ret = fs_get_dentry(root, ino, &parent);
-  if (ret != 0) {
+  if (!sb) {
     return -1;
   }
 
+  read_lock(&session->se_lock);
+
   /*
-   * Check if parent dentry has child dentries and
+   * Get parent dentry mached with ino, and
    * if child dentries exist and not be traversed yet, traverse them now,
    * otherwise just ignore it
    */
-  ret = fs_traverse_dentry(&parent);
+  ret = fs_get_dentry_traversed(session, ino, UINT32_MAX, &parent);
   if (ret != 0) {
-    return -1;
+    goto fs_getdents_exit;
   }
 
   /*
@@ -536,26 +853,33 @@ static int32_t fs_getdents(uint64_t ino, struct fs_dirent *dirents, uint32_t cou
          child = list_entry(child->d_child.prev, struct dentry, d_child)) {
 #endif
       if (++i > count) {
-        return -1;
+        ret = -1;
+        goto fs_getdents_exit;
       }
 
       ret = fs_dentry2dirent(child, &dirents[i - 1]);
       if (ret != 0) {
-        return -1;
+        goto fs_getdents_exit;
       }
     }
   }
 
-  return 0;
+  ret = 0;
+
+ fs_getdents_exit:
+
+  read_unlock(&session->se_lock);
+
+  return ret != 0 ? -1 : 0;
 }
 
 /*
  * Read file for ino
  */
-static int32_t fs_readfile(uint64_t ino, int64_t offset, char *buf, int64_t count, int64_t *num)
+static int32_t fs_readfile(struct fs_session *session, uint64_t ino, int64_t offset, char *buf, int64_t count, int64_t *num)
 {
-  struct super_block *sb = fs_mnt.mnt.mnt_sb;
-  struct inode inode;
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct inode *inode = NULL;
   struct file file;
   int32_t ret;
 
@@ -567,20 +891,23 @@ static int32_t fs_readfile(uint64_t ino, int64_t offset, char *buf, int64_t coun
     return -1;
   }
 
-  memset((void *)&inode, 0, sizeof(struct inode));
-  ret = fs_get_inode(sb, ino, &inode);
+  read_lock(&session->se_lock);
+
+  ret = fs_get_inode_mapped(session, ino, &inode);
   if (ret != 0) {
-    return -1;
+    ret = -1;
+    goto fs_readfile_unlock;
   }
 
   memset((void *)&file, 0, sizeof(struct file));
-  ret = inode.i_fop->open(&inode, &file);
+  ret = inode->i_fop->open(inode, &file);
   if (ret != 0) {
-    return -1;
+    ret = -1;
+    goto fs_readfile_unlock;
   }
 
   memset((void *)buf, 0, (size_t)count);
-  ret = inode.i_fop->readat(&file, offset, buf, (size_t)count, num);
+  ret = inode->i_fop->readat(&file, offset, buf, (size_t)count, num);
   if (ret != 0) {
     ret = -1;
     goto fs_readfile_exit;
@@ -590,11 +917,372 @@ static int32_t fs_readfile(uint64_t ino, int64_t offset, char *buf, int64_t coun
 
 fs_readfile_exit:
 
-  (void)inode.i_fop->release(&inode, &file);
+  (void)inode->i_fop->release(inode, &file);
+
+fs_readfile_unlock:
+
+  read_unlock(&session->se_lock);
 
   return ret;
 }
 
+/*
+ * Get counters of IO of filesystem
+ */
+static int32_t fs_iostats(struct fs_session *session, const char *pathname, struct fs_iostats *buf)
+{
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct io_stat stat;
+  int32_t i;
+
+  if (!pathname || !buf) {
+    return -1;
+  }
+
+  if (!sb || !sb->s_io) {
+    return -1;
+  }
+
+  memset((void *)&stat, 0, sizeof(struct io_stat));
+  if (io_stat(sb->s_io, &stat) != 0) {
+    return -1;
+  }
+
+  memset((void *)buf, 0, sizeof(struct fs_iostats));
+  buf->reads = stat.reads;
+  buf->seeks = stat.seeks;
+  buf->bytes = stat.bytes;
+  buf->cache_hits = stat.hits;
+  buf->cache_misses = stat.misses;
+
+  for (i = 0; i < IO_STAT_LAT_NUM && i < FS_IOSTATS_LAT_NUM; ++i) {
+    buf->lat[i] = stat.lat[i];
+  }
+
+  read_lock(&session->se_lock);
+
+  buf->mem = sb->s_op && sb->s_op->mem_used ? sb->s_op->mem_used(sb) : 0;
+  buf->mem_budget = sb->s_mem_budget;
+  buf->evicts = sb->s_evicts;
+
+  read_unlock(&session->se_lock);
+
+  return 0;
+}
+
+/*
+ * Get directory entries of filesystem from cursor, with stats of file
+ * if entries is not NULL, with child dentries traversed as many as needed
+ */
+static int32_t fs_readdir_helper(struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_dirent *dirents, struct fs_direntplus *entries, uint32_t count, uint32_t *num)
+{
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct dentry *parent = NULL, *child = NULL;
+  uint64_t pos;
+  uint32_t i;
+  bool read;
+  int32_t ret;
+
+  if (!cursor || (!dirents && !entries) || count == 0 || !num) {
+    return -1;
+  }
+
+  if (!sb) {
+    return -1;
+  }
+
+  read_lock(&session->se_lock);
+
+  /*
+   * Traverse child dentries up to the end of page only
+   */
+  pos = *cursor + count;
+
+  for (read = 0; ; read = 1) {
+    ret = fs_get_dentry_traversed(session, ino, pos < UINT32_MAX ? (uint32_t)pos : UINT32_MAX, &parent);
+    if (ret != 0) {
+      goto fs_readdir_helper_exit;
+    }
+
+    if (!entries || read || fs_childs_read(sb, parent, *cursor, count, 0)) {
+      break;
+    }
+
+    /*
+     * Read inodes of child dentries in page for stats,
+     * with read lock upgraded to write lock if any of them is not read yet,
+     * and dentry traversed again if it is evicted meanwhile
+     */
+    read_unlock(&session->se_lock);
+    write_lock(&session->se_lock);
+
+    ret = fs_get_dentry(sb, ino, &parent);
+    if (ret == 0) {
+      (void)fs_childs_read(sb, parent, *cursor, count, 1);
+      fs_prune(sb, parent, NULL);
+    }
+
+    write_unlock(&session->se_lock);
+    read_lock(&session->se_lock);
+
+    if (ret != 0) {
+      goto fs_readdir_helper_exit;
+    }
+  }
+
+  /*
+   * Populate child dentries in order of getdents,
+   * skipping ones returned before cursor
+   */
+  for (child = list_entry((&parent->d_subdirs)->prev, struct dentry, d_child), pos = 0, i = 0;
+       &child->d_child != (&parent->d_subdirs) && i < count;
+       child = list_entry(child->d_child.prev, struct dentry, d_child), ++pos) {
+    if (pos < *cursor) {
+      continue;
+    }
+
+    if (entries) {
+      ret = fs_dentry2dirent(child, &entries[i].dirent);
+      if (ret != 0) {
+        goto fs_readdir_helper_exit;
+      }
+
+      (void)fs_stat_helper(sb, child->d_inode, &entries[i].stat);
+    } else {
+      ret = fs_dentry2dirent(child, &dirents[i]);
+      if (ret != 0) {
+        goto fs_readdir_helper_exit;
+      }
+    }
+
+    ++i;
+  }
+
+  *cursor += i;
+  *num = i;
+
+  ret = 0;
+
+ fs_readdir_helper_exit:
+
+  read_unlock(&session->se_lock);
+
+  return ret != 0 ? -1 : 0;
+}
+
+/*
+ * Look up child dentry matched with name in directory of ino by index of it,
+ * called with read lock of session held, and return 1 if name is not found,
+ * or -1 if directory is not indexed, or index of it is not usable
+ *
+ * Read lock is upgraded to write lock, as child dentry found is instantiated
+ */
+static int32_t fs_lookup_indexed(struct fs_session *session, uint64_t ino, const char *name, uint32_t len, struct dentry **match)
+{
+  struct super_block *sb = session->se_mnt.mnt.mnt_sb;
+  struct dentry *parent = NULL;
+  int32_t ret;
+
+  read_unlock(&session->se_lock);
+  write_lock(&session->se_lock);
+
+  ret = fs_connect_dentry(sb, ino, FS_CONNECT_DEPTH_MAX, &parent);
+  if (ret == 0) {
+    *match = sb->s_op->find_dentry(parent, name, len);
+    if (*match) {
+      ret = 0;
+    } else if (parent->d_complete) {
+      ret = 1;
+    } else {
+      ret = sb->s_op->lookup_dentry(parent, name, len, match);
+      if (ret == 0 && *match) {
+        fs_prune(sb, parent, NULL);
+      } else if (ret == 0) {
+        ret = 1;
+      }
+    }
+  }
+
+  write_unlock(&session->se_lock);
+  read_lock(&session->se_lock);
+
+  return ret;
+}
+
+/*
+ * Get child dentry matched with name in directory of ino,
+ * called with read lock of session held
+ *
+ * Hash table of dentries is probed first, and then index of directory
+ * is looked up if any, or directory is traversed block by block
+ * till name is found, or the end of it
+ */
+static int32_t fs_lookup_helper(struct fs_session *session, uint64_t ino, const char *name, uint32_t len, struct dentry **match)
+{
+  struct super_block *sb = session->se_mnt.mnt.mnt_sb;
+  struct dentry *parent = NULL;
+  bool indexed = sb->s_op && sb->s_op->lookup_dentry ? 1 : 0;
+  int32_t ret;
+
+  if (!sb->s_op || !sb->s_op->find_dentry) {
+    return -1;
+  }
+
+  ret = fs_get_dentry_traversed(session, ino, 0, &parent);
+  if (ret != 0 || (parent->d_inode->i_mode & 0xF000) != IFDIR) {
+    return -1;
+  }
+
+  while (1) {
+    *match = sb->s_op->find_dentry(parent, name, len);
+    if (*match) {
+      return 0;
+    }
+
+    if (parent->d_complete || parent->d_childnum == UINT32_MAX) {
+      return -1;
+    }
+
+    if (indexed) {
+      ret = fs_lookup_indexed(session, ino, name, len, match);
+      if (ret > 0) {
+        return -1;
+      }
+
+      /*
+       * Child dentry found may be evicted once lock is downgraded,
+       * and it is probed again, or directory is traversed instead
+       * if index of it is not usable
+       */
+      if (ret < 0) {
+        indexed = 0;
+      }
+
+      ret = fs_get_dentry_traversed(session, ino, 0, &parent);
+    } else {
+      ret = fs_get_dentry_traversed(session, ino, parent->d_childnum + 1, &parent);
+    }
+
+    if (ret != 0) {
+      return -1;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Get directory entries of filesystem with stats of file,
+ * filled in from inodes instantiated with child dentries
+ */
+static int32_t fs_readdirplus(struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_direntplus *entries, uint32_t count, uint32_t *num)
+{
+  if (!entries) {
+    return -1;
+  }
+
+  return fs_readdir_helper(session, ino, cursor, NULL, entries, count, num);
+}
+
+/*
+ * Get directory entries of filesystem in page from cursor
+ */
+static int32_t fs_readdir(struct fs_session *session, uint64_t ino, uint64_t *cursor, struct fs_dirent *dirents, uint32_t count, uint32_t *num)
+{
+  if (!dirents) {
+    return -1;
+  }
+
+  return fs_readdir_helper(session, ino, cursor, dirents, NULL, count, num);
+}
+
+/*
+ * Get directory entry of filesystem matched with name in directory of ino
+ */
+static int32_t fs_lookup(struct fs_session *session, uint64_t ino, const char *name, struct fs_dirent *dirent)
+{
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct dentry *child = NULL;
+  int32_t ret;
+
+  if (!name || name[0] == '\0' || !dirent) {
+    return -1;
+  }
+
+  if (!sb) {
+    return -1;
+  }
+
+  read_lock(&session->se_lock);
+
+  ret = fs_lookup_helper(session, ino, name, strlen(name), &child);
+  if (ret == 0) {
+    ret = fs_dentry2dirent(child, dirent);
+  }
+
+  read_unlock(&session->se_lock);
+
+  return ret != 0 ? -1 : 0;
+}
+
+/*
+ * Get directory entry of filesystem matched with pathname from root of mount,
+ * with names of pathname separated by '/'
+ */
+static int32_t fs_resolve(struct fs_session *session, const char *pathname, struct fs_dirent *dirent)
+{
+  struct super_block *sb = session ? session->se_mnt.mnt.mnt_sb : NULL;
+  struct dentry *root = session ? session->se_mnt.mnt.mnt_root : NULL;
+  struct dentry *match = NULL;
+  const char *name = NULL;
+  uint64_t ino;
+  uint32_t len;
+  int32_t ret;
+
+  if (!pathname || !dirent) {
+    return -1;
+  }
+
+  if (!sb || !root) {
+    return -1;
+  }
+
+  read_lock(&session->se_lock);
+
+  ino = root->d_inode->i_ino;
+  ret = 0;
+
+  for (name = pathname; *name != '\0'; name += len) {
+    if (*name == '/') {
+      len = 1;
+      continue;
+    }
+
+    for (len = 0; name[len] != '\0' && name[len] != '/'; ++len);
+
+    ret = fs_lookup_helper(session, ino, name, len, &match);
+    if (ret != 0) {
+      goto fs_resolve_exit;
+    }
+
+    ino = match->d_inode->i_ino;
+  }
+
+  /*
+   * Get dentry instantiated first for ino, instead of '.' or '..'
+   */
+  ret = fs_get_dentry(sb, ino, &match);
+  if (ret == 0) {
+    ret = fs_dentry2dirent(match, dirent);
+  }
+
+ fs_resolve_exit:
+
+  read_unlock(&session->se_lock);
+
+  return ret != 0 ? -1 : 0;
+}
+
 /*
  * Init filesystem operation
  */
@@ -617,6 +1305,11 @@ __declspec(dllexport) int32_t fs_opt_init(struct fs_opt_t *fs_opt)
   fs_opt->querydent = fs_querydent;
   fs_opt->getdents = fs_getdents;
   fs_opt->readfile = fs_readfile;
+  fs_opt->iostats = fs_iostats;
+  fs_opt->readdirplus = fs_readdirplus;
+  fs_opt->readdir = fs_readdir;
+  fs_opt->lookup = fs_lookup;
+  fs_opt->resolve = fs_resolve;
 
   return 0;
 }
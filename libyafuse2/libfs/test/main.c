@@ -51,6 +51,22 @@
 #define LIB_NAME "libyafuse2.dll"
 #endif /* CMAKE_COMPILER_IS_GNUCC */
 
+/*
+ * Number of dirents per call of readdir
+ */
+#define DIRENTS_NUM 8
+
+/*
+ * Number of dirents with stats per call of readdirplus
+ */
+#define DIRENTS_PLUS_NUM 8
+
+/*
+ * Length per call of readfile, not aligned to block,
+ * so that reads start and end within blocks
+ */
+#define READ_LEN 1000
+
 /*
  * Type Definition
  */
@@ -70,7 +86,9 @@ static void* load_lib(const char *lib_name);
 static void* get_sym(void *handle, const char *symbol);
 static void unload_lib(void *handle);
 static void show_stat(struct fs_kstat *stat);
-static void traverse_dents(struct fs_dirent *dent, struct fs_opt_t *opt);
+static void show_iostats(struct fs_iostats *stats);
+static void traverse_dents(struct fs_dirent *dent, struct fs_opt_t *opt, struct fs_session *session);
+static int32_t read_file(struct fs_opt_t *opt, struct fs_session *session, uint64_t ino, int64_t size);
 
 /*
  * Function Definition
@@ -155,54 +173,131 @@ static void show_stat(struct fs_kstat *stat)
   info("blocks: %llu", (long long unsigned)stat->blocks);
 }
 
-static void traverse_dents(struct fs_dirent *dent, struct fs_opt_t *opt)
+static void show_iostats(struct fs_iostats *stats)
+{
+  int32_t i;
+
+  info("reads: %llu", (long long unsigned)stats->reads);
+  info("seeks: %llu", (long long unsigned)stats->seeks);
+  info("bytes: %llu", (long long unsigned)stats->bytes);
+  info("cache hits: %llu", (long long unsigned)stats->cache_hits);
+  info("cache misses: %llu", (long long unsigned)stats->cache_misses);
+
+  for (i = 0; i < FS_IOSTATS_LAT_NUM; ++i) {
+    if (stats->lat[i] == 0) {
+      continue;
+    }
+
+    if (i == FS_IOSTATS_LAT_NUM - 1) {
+      info("latency >= %lluus: %llu", (long long unsigned)1 << (i - 1), (long long unsigned)stats->lat[i]);
+    } else {
+      info("latency < %lluus: %llu", (long long unsigned)1 << i, (long long unsigned)stats->lat[i]);
+    }
+  }
+
+  info("mem: %llu", (long long unsigned)stats->mem);
+  info("mem budget: %llu", (long long unsigned)stats->mem_budget);
+  info("evicts: %llu", (long long unsigned)stats->evicts);
+}
+
+static void traverse_dents(struct fs_dirent *dent, struct fs_opt_t *opt, struct fs_session *session)
 {
   uint64_t ino = dent->d_ino;
-  struct fs_dirent parent;
+  struct fs_dirent childs[DIRENTS_NUM];
+  uint64_t cursor = 0;
   uint32_t num;
-  struct fs_dirent *childs = NULL;
   const char *name = NULL;
   int32_t i;
 
-  (void)opt->querydent(ino, &parent);
-
-  num = parent.d_childnum;
-  if (num == 0) {
+  if (dent->d_type != FT_DIR) {
     return;
   }
 
-  childs = (struct fs_dirent *)malloc(num * sizeof(struct fs_dirent));
-  if (!childs) {
-    return;
-  }
-  memset((void *)childs, 0, sizeof(struct fs_dirent) * num);
+  do {
+    memset((void *)childs, 0, sizeof(childs));
+    if (opt->readdir(session, ino, &cursor, childs, DIRENTS_NUM, &num) != 0) {
+      return;
+    }
 
-  (void)opt->getdents(ino, childs, num);
+    for (i = 0; i < (int)num; ++i) {
+      name = childs[i].d_name;
 
-  for (i = 0; i < (int)num; ++i) {
-    name = childs[i].d_name;
+      if (!strcmp(name, FS_DNAME_DOT)
+          || !strcmp(name, FS_DNAME_DOTDOT)) {
+        continue;
+      }
 
-    if (!strcmp(name, FS_DNAME_DOT)
-        || !strcmp(name, FS_DNAME_DOTDOT)) {
-      continue;
+      info("name %s ino %llu type %d", childs[i].d_name, (long long unsigned)childs[i].d_ino, childs[i].d_type);
+
+      traverse_dents(&childs[i], opt, session);
+    }
+  } while (num == DIRENTS_NUM);
+}
+
+/*
+ * Read file in whole, then in pieces of READ_LEN, and check that
+ * both return size of file and the same data
+ */
+static int32_t read_file(struct fs_opt_t *opt, struct fs_session *session, uint64_t ino, int64_t size)
+{
+  char *data = NULL;
+  char buf[READ_LEN];
+  int64_t offset, num;
+  int32_t ret = -1;
+
+  data = (char *)malloc((size_t)(size + 1));
+  if (!data) {
+    return -1;
+  }
+
+  for (offset = 0; offset < size; offset += num) {
+    if (opt->readfile(session, ino, offset, data + offset, size - offset, &num) != 0 || num <= 0) {
+      goto read_file_exit;
     }
+  }
 
-    info("name %s ino %llu type %d", childs[i].d_name, (long long unsigned)childs[i].d_ino, childs[i].d_type);
+  for (offset = 0; offset < size; offset += num) {
+    if (opt->readfile(session, ino, offset, buf, READ_LEN, &num) != 0 || num <= 0 || num > size - offset) {
+      goto read_file_exit;
+    }
 
-    traverse_dents(&childs[i], opt);
+    if (memcmp((const void *)buf, (const void *)(data + offset), (size_t)num) != 0) {
+      goto read_file_exit;
+    }
   }
+
+  /*
+   * Read at end of file
+   */
+  if (opt->readfile(session, ino, size, buf, READ_LEN, &num) != 0 || num != 0) {
+    goto read_file_exit;
+  }
+
+  ret = 0;
+
+ read_file_exit:
+
+  free((void *)data);
+
+  return ret;
 }
 
 int32_t main(int argc, char *argv[])
 {
   const char *fs_type = NULL, *fs_img = NULL, *fs_mnt = NULL;
   struct fs_opt_t fs_opt;
+  struct fs_session *fs_session = NULL;
   struct fs_dirent fs_root;
   struct fs_kstatfs fs_statfs;
   struct fs_kstat fs_stat;
+  struct fs_iostats fs_iostats;
   struct fs_dirent fs_dirent;
   struct fs_dirent *fs_dirents = NULL;
+  struct fs_dirent fs_dirent_found;
+  char fs_path[FS_DNAME_LEN + 2];
   uint32_t fs_dirents_num;
+  struct fs_direntplus fs_direntsplus[DIRENTS_PLUS_NUM];
+  uint64_t fs_cursor;
   uint64_t ino;
   uint32_t i;
   int32_t ret = 0;
@@ -246,7 +341,7 @@ int32_t main(int argc, char *argv[])
    * Mount fs image
    */
   memset((void *)&fs_root, 0, sizeof(struct fs_dirent));
-  ret = fs_opt.mount(fs_img, fs_mnt, fs_type, 0, &fs_root);
+  ret = fs_opt.mount(fs_img, fs_mnt, fs_type, 0, &fs_root, &fs_session);
   if (ret != 0) {
     error("mount failed!");
     goto main_exit;
@@ -262,7 +357,7 @@ int32_t main(int argc, char *argv[])
    * Show stats of fs
    */
   memset((void *)&fs_statfs, 0, sizeof(struct fs_kstatfs));
-  ret = fs_opt.statfs(fs_mnt, &fs_statfs);
+  ret = fs_opt.statfs(fs_session, fs_mnt, &fs_statfs);
   if (ret != 0) {
     error("statfs failed!");
     goto main_exit;
@@ -272,7 +367,7 @@ int32_t main(int argc, char *argv[])
    * Show stats of file
    */
   memset((void *)&fs_stat, 0, sizeof(struct fs_kstat));
-  ret = fs_opt.stat(fs_root.d_ino, &fs_stat);
+  ret = fs_opt.stat(fs_session, fs_root.d_ino, &fs_stat);
   if (ret != 0) {
     error("stat failed!");
     goto main_exit;
@@ -287,7 +382,7 @@ int32_t main(int argc, char *argv[])
    */
   ino = fs_root.d_ino;
 
-  ret = fs_opt.querydent(ino, &fs_dirent);
+  ret = fs_opt.querydent(fs_session, ino, &fs_dirent);
   if (ret != 0) {
     error("querydent failed!");
     goto main_exit;
@@ -301,7 +396,7 @@ int32_t main(int argc, char *argv[])
   }
   memset((void *)fs_dirents, 0, sizeof(struct fs_dirent) * fs_dirents_num);
 
-  ret = fs_opt.getdents(ino, fs_dirents, fs_dirents_num);
+  ret = fs_opt.getdents(fs_session, ino, fs_dirents, fs_dirents_num);
   if (ret != 0) {
     error("getdents failed!");
     goto main_exit;
@@ -313,11 +408,94 @@ int32_t main(int argc, char *argv[])
   }
   fprintf(stdout, "\n");
 
+  /*
+   * Get dentry list with stats, page by page
+   */
+  fprintf(stdout, "-- dentry list plus (ino %llu) --\n", (long long unsigned)ino);
+
+  fs_cursor = 0;
+
+  do {
+    ret = fs_opt.readdirplus(fs_session, ino, &fs_cursor, fs_direntsplus, DIRENTS_PLUS_NUM, &fs_dirents_num);
+    if (ret != 0) {
+      error("readdirplus failed!");
+      goto main_exit;
+    }
+
+    for (i = 0; i < fs_dirents_num; ++i) {
+      info("name %s ino %llu type %d size %lld", fs_direntsplus[i].dirent.d_name, (long long unsigned)fs_direntsplus[i].dirent.d_ino, fs_direntsplus[i].dirent.d_type, (long long int)fs_direntsplus[i].stat.size);
+    }
+  } while (fs_dirents_num == DIRENTS_PLUS_NUM);
+
+  fprintf(stdout, "\n");
+
   /*
    * Traverse all dentries
    */
   fprintf(stdout, "-- traverse all dentries --\n");
-  traverse_dents(&fs_root, &fs_opt);
+  traverse_dents(&fs_root, &fs_opt, fs_session);
+  fprintf(stdout, "\n");
+
+  /*
+   * Look up and resolve path of dentries in list
+   */
+  fprintf(stdout, "-- resolve path --\n");
+  for (i = 0; i < fs_dirent.d_childnum; ++i) {
+    ret = fs_opt.lookup(fs_session, ino, fs_dirents[i].d_name, &fs_dirent_found);
+    if (ret != 0 || fs_dirent_found.d_ino != fs_dirents[i].d_ino) {
+      error("lookup failed!");
+      goto main_exit;
+    }
+
+    snprintf(fs_path, sizeof(fs_path), "/%s", fs_dirents[i].d_name);
+
+    ret = fs_opt.resolve(fs_session, fs_path, &fs_dirent_found);
+    if (ret != 0) {
+      error("resolve failed!");
+      goto main_exit;
+    }
+
+    info("path %s ino %llu type %d", fs_path, (long long unsigned)fs_dirent_found.d_ino, fs_dirent_found.d_type);
+  }
+  fprintf(stdout, "\n");
+
+  /*
+   * Read files in list
+   */
+  fprintf(stdout, "-- read file --\n");
+  for (i = 0; i < fs_dirent.d_childnum; ++i) {
+    if (fs_dirents[i].d_type != FT_REG_FILE) {
+      continue;
+    }
+
+    ret = fs_opt.stat(fs_session, fs_dirents[i].d_ino, &fs_stat);
+    if (ret != 0) {
+      error("stat failed!");
+      goto main_exit;
+    }
+
+    ret = read_file(&fs_opt, fs_session, fs_dirents[i].d_ino, fs_stat.size);
+    if (ret != 0) {
+      error("readfile failed!");
+      goto main_exit;
+    }
+
+    info("name %s ino %llu size %lld", fs_dirents[i].d_name, (long long unsigned)fs_dirents[i].d_ino, (long long int)fs_stat.size);
+  }
+  fprintf(stdout, "\n");
+
+  /*
+   * Show stats of IO
+   */
+  memset((void *)&fs_iostats, 0, sizeof(struct fs_iostats));
+  ret = fs_opt.iostats(fs_session, fs_mnt, &fs_iostats);
+  if (ret != 0) {
+    error("iostats failed!");
+    goto main_exit;
+  }
+
+  fprintf(stdout, "-- io stats --\n");
+  show_iostats(&fs_iostats);
   fprintf(stdout, "\n");
 
   ret = 0;
@@ -332,8 +510,8 @@ main_exit:
   /*
    * Umount fs image
    */
-  if (fs_opt.umount) {
-    (void)fs_opt.umount(fs_mnt, 0);
+  if (fs_opt.umount && fs_session) {
+    (void)fs_opt.umount(fs_session, fs_mnt, 0);
 
     if (ret == 0) {
       fprintf(stdout, "unmount filesystem successfully.\n");
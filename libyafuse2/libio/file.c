@@ -0,0 +1,762 @@
+/**
+ * file.c - File backend of IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _LARGEFILE64_SOURCE
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#ifdef CMAKE_COMPILER_IS_GNUCC
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+#ifdef DEBUG
+#define DEBUG_LIBIO_FILE
+#endif
+
+#include "include/base/debug.h"
+#include "include/base/lock.h"
+#include "include/libio/io.h"
+#include "include/libio/ring.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * Largest length passed to a single read/write call,
+ * since 'size_t' is narrowed to 32-bit in include/base/types.h
+ */
+#define IO_FILE_RW_LEN_MAX  (0x40000000)
+
+/*
+ * Max number of vectors per vectored read
+ */
+#define IO_FILE_VEC_MAX  (64)
+
+/*
+ * Direct IO: alignment of offset, length & buffer,
+ * min length of read to go direct, and pool of bounce buffers
+ */
+#define IO_DIRECT_ALIGN    (0x1000)
+#define IO_DIRECT_LEN_MIN  (0x10000)
+#define IO_DIRECT_BUF_SZ   (0x100000)
+#define IO_DIRECT_BUF_NUM  (4)
+
+/*
+ * Type Definition
+ */
+struct io_file {
+  int fd;
+  int64_t size;
+
+  /*
+   * Read-only mapping of the whole file,
+   * NULL if mapping fails and pread is used instead
+   */
+  const uint8_t *map;
+
+  /*
+   * Ring of io_uring for batched read, opened on first use,
+   * and disabled if not supported
+   */
+  struct io_ring *ring;
+  bool ring_off;
+
+  /*
+   * Direct IO for bulk read, with fd opened by O_DIRECT,
+   * -1 if disabled, and pool of aligned bounce buffers
+   */
+  char *name;
+  int dfd;
+  uint8_t *dbufs[IO_DIRECT_BUF_NUM];
+  bool dbufs_used[IO_DIRECT_BUF_NUM];
+
+  uint64_t seeks;
+
+  /*
+   * Lock of ring, pool of bounce buffers, seeks,
+   * and seek & read of file on Win32
+   */
+  struct mutex lock;
+};
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static void io_file_map_open(struct io_file *file);
+static void io_file_map_close(struct io_file *file);
+static int64_t io_file_pread_raw(struct io_file *file, int64_t offset, uint8_t *data, int64_t len);
+static uint8_t* io_file_direct_get(struct io_file *file);
+static void io_file_direct_put(struct io_file *file, uint8_t *buf);
+static int64_t io_file_pread_direct(struct io_file *file, int64_t offset, uint8_t *data, int64_t len);
+static void io_file_close(void *priv);
+static int64_t io_file_pread(void *priv, int64_t offset, uint8_t *data, int64_t len);
+static int64_t io_file_pwrite(void *priv, int64_t offset, const uint8_t *data, int64_t len);
+static int64_t io_file_preadv(void *priv, int64_t offset, const struct io_vec *vecs, uint32_t num);
+static int32_t io_file_pread_batch(void *priv, struct io_req *reqs, uint32_t num);
+static const uint8_t* io_file_map(void *priv, int64_t offset, int64_t len);
+static void io_file_advise(void *priv, int64_t offset, int64_t len);
+static int32_t io_file_direct(void *priv, bool enable);
+static void io_file_stat(void *priv, struct io_stat *stat);
+
+static struct io_ops io_file_ops = {
+  //.name =
+  "file",
+
+  //.close =
+  io_file_close,
+
+  //.pread =
+  io_file_pread,
+
+  //.pwrite =
+  io_file_pwrite,
+
+  //.preadv =
+  io_file_preadv,
+
+  //.pread_batch =
+  io_file_pread_batch,
+
+  //.map =
+  io_file_map,
+
+  //.advise =
+  io_file_advise,
+
+  //.direct =
+  io_file_direct,
+
+  //.stat =
+  io_file_stat,
+};
+
+/*
+ * Function Definition
+ */
+/*
+ * Map file into memory
+ */
+static void io_file_map_open(struct io_file *file)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  void *addr = NULL;
+
+  file->map = NULL;
+
+  /*
+   * Keep pread for empty file, or for file larger than address space,
+   * e.g., huge image on 32-bit host
+   */
+  if (file->size <= 0 || (uint64_t)file->size > (uint64_t)(UINTPTR_MAX >> 1)) {
+    return;
+  }
+
+  addr = mmap(NULL, (uintptr_t)file->size, PROT_READ, MAP_SHARED, file->fd, 0);
+  if (addr == MAP_FAILED) {
+    return;
+  }
+
+  file->map = (const uint8_t *)addr;
+#else
+  file->map = NULL;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+/*
+ * Unmap file from memory
+ */
+static void io_file_map_close(struct io_file *file)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  if (file->map) {
+    (void)munmap((void *)file->map, (uintptr_t)file->size);
+  }
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+  file->map = NULL;
+}
+
+/*
+ * Read file at offset by buffered IO
+ */
+static int64_t io_file_pread_raw(struct io_file *file, int64_t offset, uint8_t *data, int64_t len)
+{
+  int64_t done, chunk;
+  int64_t ret;
+
+  if (file->map) {
+    if (offset >= file->size) {
+      return 0;
+    }
+
+    len = len > file->size - offset ? file->size - offset : len;
+    memcpy((void *)data, (const void *)(file->map + offset), (uintptr_t)len);
+
+    return len;
+  }
+
+  for (done = 0; done < len; done += ret) {
+    chunk = len - done > IO_FILE_RW_LEN_MAX ? IO_FILE_RW_LEN_MAX : len - done;
+
+#ifdef CMAKE_COMPILER_IS_GNUCC
+    ret = (int64_t)pread64(file->fd, (void *)(data + done), (size_t)chunk, (off64_t)(offset + done));
+#else
+    /*
+     * No pread on Win32, so fall back to seek & read,
+     * with offset of file shared by threads
+     */
+    mutex_lock(&file->lock);
+    file->seeks += 1;
+    if (lseek64(file->fd, offset + done, SEEK_SET) == -1) {
+      mutex_unlock(&file->lock);
+      return -1;
+    }
+
+    ret = (int64_t)read(file->fd, (void *)(data + done), (size_t)chunk);
+    mutex_unlock(&file->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+    if (ret == -1) {
+      if (errno == EINTR) {
+        ret = 0;
+        continue;
+      }
+
+      return -1;
+    }
+
+    if (ret == 0) {
+      break;
+    }
+  }
+
+  return done;
+}
+
+/*
+ * Get bounce buffer from pool of direct IO
+ */
+static uint8_t* io_file_direct_get(struct io_file *file)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  void *buf = NULL;
+  int32_t i;
+
+  mutex_lock(&file->lock);
+
+  for (i = 0; i < IO_DIRECT_BUF_NUM; ++i) {
+    if (file->dbufs_used[i]) {
+      continue;
+    }
+
+    if (!file->dbufs[i]) {
+      if (posix_memalign(&buf, IO_DIRECT_ALIGN, IO_DIRECT_BUF_SZ) != 0) {
+        break;
+      }
+      file->dbufs[i] = (uint8_t *)buf;
+    }
+
+    file->dbufs_used[i] = 1;
+    mutex_unlock(&file->lock);
+
+    return file->dbufs[i];
+  }
+
+  mutex_unlock(&file->lock);
+#else
+  file = file;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+  return NULL;
+}
+
+/*
+ * Put bounce buffer back to pool of direct IO
+ */
+static void io_file_direct_put(struct io_file *file, uint8_t *buf)
+{
+  int32_t i;
+
+  mutex_lock(&file->lock);
+
+  for (i = 0; i < IO_DIRECT_BUF_NUM; ++i) {
+    if (file->dbufs[i] == buf) {
+      file->dbufs_used[i] = 0;
+      break;
+    }
+  }
+
+  mutex_unlock(&file->lock);
+}
+
+/*
+ * Read file at offset by direct IO, bypassing page cache
+ * return length of read, which is short only at the end of file
+ */
+static int64_t io_file_pread_direct(struct io_file *file, int64_t offset, uint8_t *data, int64_t len)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  uint8_t *buf = NULL, *dst = NULL;
+  int64_t done, pos, start, skip, want, ret;
+
+  buf = io_file_direct_get(file);
+  if (!buf) {
+    return io_file_pread_raw(file, offset, data, len);
+  }
+
+  for (done = 0; done < len;) {
+    pos = offset + done;
+
+    /*
+     * Read into buffer of caller if all aligned, or else bounce
+     */
+    if ((pos | (int64_t)(uintptr_t)(data + done)) % IO_DIRECT_ALIGN == 0 && len - done >= IO_DIRECT_ALIGN) {
+      start = pos;
+      skip = 0;
+      want = len - done > IO_FILE_RW_LEN_MAX ? IO_FILE_RW_LEN_MAX : len - done;
+      want -= want % IO_DIRECT_ALIGN;
+      dst = data + done;
+    } else {
+      start = pos - pos % IO_DIRECT_ALIGN;
+      skip = pos - start;
+      want = skip + len - done + IO_DIRECT_ALIGN - 1;
+      want -= want % IO_DIRECT_ALIGN;
+      want = want > IO_DIRECT_BUF_SZ ? IO_DIRECT_BUF_SZ : want;
+      dst = buf;
+    }
+
+    ret = (int64_t)pread64(file->dfd, (void *)dst, (size_t)want, (off64_t)start);
+    if (ret == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      io_file_direct_put(file, buf);
+
+      /*
+       * Fall back to buffered read if direct IO is refused, e.g., by alignment
+       */
+      if (errno == EINVAL) {
+        ret = io_file_pread_raw(file, pos, data + done, len - done);
+        return ret < 0 ? -1 : done + ret;
+      }
+
+      return -1;
+    }
+
+    if (ret <= skip) {
+      break;
+    }
+
+    ret = ret - skip > len - done ? len - done : ret - skip;
+    if (dst == buf) {
+      memcpy((void *)(data + done), (const void *)(buf + skip), (uintptr_t)ret);
+    }
+
+    done += ret;
+
+    if (ret < want - skip && done < len) {
+      break;
+    }
+  }
+
+  io_file_direct_put(file, buf);
+
+  return done;
+#else
+  return io_file_pread_raw(file, offset, data, len);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+static void io_file_close(void *priv)
+{
+  struct io_file *file = (struct io_file *)priv;
+
+  (void)io_file_direct(priv, 0);
+  io_ring_close(file->ring);
+  io_file_map_close(file);
+
+  if (file->fd != -1) {
+    (void)close(file->fd);
+    file->fd = -1;
+  }
+
+  mutex_destroy(&file->lock);
+  free((void *)file->name);
+  free((void *)file);
+}
+
+static int64_t io_file_pread(void *priv, int64_t offset, uint8_t *data, int64_t len)
+{
+  struct io_file *file = (struct io_file *)priv;
+
+  /*
+   * Read bulk file data by direct IO if enabled
+   */
+  if (file->dfd != -1 && len >= IO_DIRECT_LEN_MIN) {
+    return io_file_pread_direct(file, offset, data, len);
+  }
+
+  return io_file_pread_raw(file, offset, data, len);
+}
+
+static int64_t io_file_pwrite(void *priv, int64_t offset, const uint8_t *data, int64_t len)
+{
+  struct io_file *file = (struct io_file *)priv;
+  int64_t done, chunk;
+  int64_t ret;
+
+  for (done = 0; done < len; done += ret) {
+    chunk = len - done > IO_FILE_RW_LEN_MAX ? IO_FILE_RW_LEN_MAX : len - done;
+
+#ifdef CMAKE_COMPILER_IS_GNUCC
+    ret = (int64_t)pwrite64(file->fd, (const void *)(data + done), (size_t)chunk, (off64_t)(offset + done));
+#else
+    mutex_lock(&file->lock);
+    file->seeks += 1;
+    if (lseek64(file->fd, offset + done, SEEK_SET) == -1) {
+      mutex_unlock(&file->lock);
+      return -1;
+    }
+
+    ret = (int64_t)write(file->fd, (const void *)(data + done), (size_t)chunk);
+    mutex_unlock(&file->lock);
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+    if (ret == -1) {
+      if (errno == EINTR) {
+        ret = 0;
+        continue;
+      }
+
+      return -1;
+    }
+
+    if (ret == 0) {
+      break;
+    }
+  }
+
+  return done;
+}
+
+/*
+ * Read file at offset into vectors by one syscall per IO_FILE_VEC_MAX vectors
+ */
+static int64_t io_file_preadv(void *priv, int64_t offset, const struct io_vec *vecs, uint32_t num)
+{
+  struct io_file *file = (struct io_file *)priv;
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  struct iovec iov[IO_FILE_VEC_MAX];
+  int64_t skip, rem, sum;
+  uint32_t cnt;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+  int64_t done, ret;
+  uint32_t i;
+
+  done = 0;
+
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  if (!file->map && file->dfd == -1) {
+    for (i = 0, skip = 0; i < num;) {
+      for (cnt = 0, sum = 0; i + cnt < num && cnt < IO_FILE_VEC_MAX && sum < IO_FILE_RW_LEN_MAX; ++cnt) {
+        rem = vecs[i + cnt].len - (cnt == 0 ? skip : 0);
+        rem = rem > IO_FILE_RW_LEN_MAX - sum ? IO_FILE_RW_LEN_MAX - sum : rem;
+
+        iov[cnt].iov_base = (void *)(vecs[i + cnt].data + (cnt == 0 ? skip : 0));
+        iov[cnt].iov_len = (uintptr_t)rem;
+        sum += rem;
+      }
+
+      ret = (int64_t)preadv64(file->fd, iov, (int)cnt, (off64_t)(offset + done));
+      if (ret == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return -1;
+      }
+
+      if (ret == 0) {
+        break;
+      }
+
+      done += ret;
+
+      /*
+       * Step over vectors read, maybe ending in the middle of one
+       */
+      while (ret > 0) {
+        rem = vecs[i].len - skip;
+
+        if (ret >= rem) {
+          ret -= rem;
+          skip = 0;
+          ++i;
+        } else {
+          skip += ret;
+          ret = 0;
+        }
+      }
+    }
+
+    return done;
+  }
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+  /*
+   * Read vector by vector if mapped or direct, or no preadv on Win32
+   */
+  for (i = 0; i < num; ++i) {
+    ret = io_file_pread(priv, offset + done, vecs[i].data, vecs[i].len);
+    if (ret < 0) {
+      return -1;
+    }
+
+    done += ret;
+
+    if (ret < vecs[i].len) {
+      break;
+    }
+  }
+
+  return done;
+}
+
+/*
+ * Read file in batch by io_uring
+ * return 0 if requests are read, and leave ret of request -1 if not read
+ */
+static int32_t io_file_pread_batch(void *priv, struct io_req *reqs, uint32_t num)
+{
+  struct io_file *file = (struct io_file *)priv;
+  uint32_t i;
+
+  /*
+   * Leave requests to pread, to read bulk ones by direct IO
+   */
+  if (file->dfd != -1) {
+    return -1;
+  }
+
+  if (file->map) {
+    /*
+     * Advise all ranges first, so that page faults of mapping
+     * are served by reads issued in parallel
+     */
+    for (i = 0; i < num; ++i) {
+      if (reqs[i].offset < file->size) {
+        io_file_advise(priv, reqs[i].offset, reqs[i].len > file->size - reqs[i].offset ? file->size - reqs[i].offset : reqs[i].len);
+      }
+    }
+
+    return -1;
+  }
+
+  /*
+   * Ring is used by one batch at a time
+   */
+  mutex_lock(&file->lock);
+
+  if (!file->ring && !file->ring_off) {
+    file->ring = io_ring_open(file->fd, IO_RING_ENTRIES);
+    file->ring_off = file->ring ? 0 : 1;
+  }
+
+  if (!file->ring) {
+    mutex_unlock(&file->lock);
+    return -1;
+  }
+
+  if (io_ring_pread(file->ring, reqs, num) != 0) {
+    io_ring_close(file->ring);
+    file->ring = NULL;
+    file->ring_off = 1;
+  }
+
+  mutex_unlock(&file->lock);
+
+  return 0;
+}
+
+static const uint8_t* io_file_map(void *priv, int64_t offset, int64_t len)
+{
+  struct io_file *file = (struct io_file *)priv;
+
+  len = len;
+
+  return file->map ? file->map + offset : NULL;
+}
+
+/*
+ * Advise kernel of range to be read soon
+ */
+static void io_file_advise(void *priv, int64_t offset, int64_t len)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  struct io_file *file = (struct io_file *)priv;
+  int64_t page, start;
+
+  /*
+   * No readahead into page cache bypassed by direct IO
+   */
+  if (file->dfd != -1) {
+    return;
+  }
+
+  if (file->map) {
+    page = (int64_t)sysconf(_SC_PAGESIZE);
+    page = page > 0 ? page : 4096;
+    start = offset - offset % page;
+    (void)posix_madvise((void *)(file->map + start), (uintptr_t)(len + offset - start), POSIX_MADV_WILLNEED);
+  } else {
+    (void)posix_fadvise64(file->fd, (off64_t)offset, (off64_t)len, POSIX_FADV_WILLNEED);
+  }
+#else
+  /*
+   * No readahead advice on Win32
+   */
+  priv = priv;
+  offset = offset;
+  len = len;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+/*
+ * Enable or disable direct IO
+ * return -1 if O_DIRECT is not supported by platform or filesystem of file
+ */
+static int32_t io_file_direct(void *priv, bool enable)
+{
+  struct io_file *file = (struct io_file *)priv;
+  int32_t i;
+
+  if (enable) {
+    if (file->dfd != -1) {
+      return 0;
+    }
+
+#if defined(CMAKE_COMPILER_IS_GNUCC) && defined(O_DIRECT)
+    file->dfd = open64(file->name, O_RDONLY | O_DIRECT);
+    return file->dfd == -1 ? -1 : 0;
+#else
+    return -1;
+#endif /* CMAKE_COMPILER_IS_GNUCC && O_DIRECT */
+  }
+
+  if (file->dfd != -1) {
+    (void)close(file->dfd);
+    file->dfd = -1;
+  }
+
+  for (i = 0; i < IO_DIRECT_BUF_NUM; ++i) {
+    if (file->dbufs[i]) {
+      free((void *)file->dbufs[i]);
+      file->dbufs[i] = NULL;
+    }
+    file->dbufs_used[i] = 0;
+  }
+
+  return 0;
+}
+
+static void io_file_stat(void *priv, struct io_stat *stat)
+{
+  struct io_file *file = (struct io_file *)priv;
+
+  mutex_lock(&file->lock);
+  stat->seeks += file->seeks;
+  mutex_unlock(&file->lock);
+}
+
+/*
+ * Open IO of file
+ */
+struct io_ctx* io_open_file(const char *fs_name)
+{
+  struct io_file *file = NULL;
+  struct io_ctx *ctx = NULL;
+
+  if (fs_name == NULL) {
+    return NULL;
+  }
+
+  file = (struct io_file *)malloc(sizeof(struct io_file));
+  if (!file) {
+    return NULL;
+  }
+  memset((void *)file, 0, sizeof(struct io_file));
+  file->dfd = -1;
+
+  if (mutex_init(&file->lock) != 0) {
+    free((void *)file);
+    return NULL;
+  }
+
+  file->name = (char *)malloc(strlen(fs_name) + 1);
+  if (!file->name) {
+    mutex_destroy(&file->lock);
+    free((void *)file);
+    return NULL;
+  }
+  memcpy((void *)file->name, (const void *)fs_name, strlen(fs_name) + 1);
+
+  file->fd = open64(fs_name, O_RDONLY);
+  if (file->fd == -1) {
+    goto io_open_file_fail;
+  }
+
+  file->size = (int64_t)lseek64(file->fd, 0, SEEK_END);
+  file->seeks += 1;
+  if (file->size == -1) {
+    goto io_open_file_fail;
+  }
+
+  io_file_map_open(file);
+
+  ctx = io_open_ops(&io_file_ops, (void *)file, file->size);
+  if (!ctx) {
+    goto io_open_file_fail;
+  }
+
+  return ctx;
+
+ io_open_file_fail:
+
+  io_file_close((void *)file);
+
+  return NULL;
+}
@@ -19,152 +19,973 @@
  * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#define _LARGEFILE64_SOURCE
-
 #include "config.h"
 #include <stdio.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <stdint.h>
-#include <fcntl.h>
 #include <string.h>
+#include <ctype.h>
+#include <time.h>
 #include <sys/types.h>
-#ifdef CMAKE_COMPILER_IS_GNUCC
-#include <unistd.h>
-#endif /* CMAKE_COMPILER_IS_GNUCC */
 
 #ifdef DEBUG
 #define DEBUG_LIBIO_IO
 #endif
 
 #include "include/base/debug.h"
+#include "include/base/lock.h"
 #include "include/libio/io.h"
+#include "include/libio/sparse.h"
 
 /*
  * Macro Definition
  */
+/*
+ * Largest length of block of cache,
+ * since 'size_t' is narrowed to 32-bit in include/base/types.h
+ */
+#define IO_CACHE_BLKSZ_MAX  (0x40000000)
+
+/*
+ * Number of hash buckets per cache block
+ */
+#define IO_CACHE_HASH_RATIO  (2)
+
+/*
+ * Range of readahead window
+ */
+#define IO_RA_WIN_MIN  (0x20000)
+#define IO_RA_WIN_MAX  (0x200000)
+
+/*
+ * Max number of vectors per vectored read
+ */
+#define IO_VEC_MAX  (64)
 
 /*
  * Type Definition
  */
+struct io_cache_blk {
+  struct list_head lru;
+  struct io_cache_blk *hash_next;
+  int64_t blk;
+  int64_t len;
+  uint8_t *data;
+};
+
+struct io_cache {
+  int64_t blksz;
+  uint32_t blks_num;
+  uint32_t hash_mask;
+  struct io_cache_blk *blks;
+  struct io_cache_blk **hash;
+  uint8_t *buf;
+
+  /*
+   * Most recently used block at head
+   */
+  struct list_head lru;
+
+  uint64_t hits;
+  uint64_t misses;
+};
+
+/*
+ * Virtual device of IO, with backend of ops & priv,
+ * e.g., file, memory buffer, byte range of device, Android sparse image
+ * or segmented image
+ *
+ * IO is read by threads concurrently, with lock held only to update
+ * cache, readahead and counters, and not across reads of backend
+ */
+struct io_ctx {
+  const struct io_ops *ops;
+  void *priv;
+  int64_t size;
+  struct mutex lock;
+
+  /*
+   * Block cache for sub-block reads, NULL if disabled
+   */
+  struct io_cache *cache;
+
+  /*
+   * Readahead of sequential reads:
+   * offset expected for next sequential read,
+   * end of range advised, and size of window
+   */
+  int64_t ra_next;
+  int64_t ra_end;
+  int64_t ra_win;
+
+  /*
+   * Counters of IO
+   */
+  struct io_stat stat;
+};
 
 /*
  * Global Variable Definition
  */
-static int io_fd = -1;
 
 /*
  * Function Declaration
  */
+static uint64_t io_time_ns(void);
+static void io_stat_read(struct io_ctx *ctx, uint64_t start, uint64_t reads, int64_t bytes);
+static void io_readahead(struct io_ctx *ctx, int64_t offset, int64_t len);
+static void io_read_done(struct io_ctx *ctx, uint64_t start, int64_t offset, int64_t ret);
+static int64_t io_pread_raw(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len);
+static struct io_cache_blk* io_cache_find(struct io_cache *cache, int64_t blk);
+static void io_cache_unhash(struct io_cache *cache, struct io_cache_blk *cb);
+static int64_t io_cache_copy(struct io_cache *cache, struct io_cache_blk *cb, int64_t offset, uint8_t *data, int64_t len);
+static int64_t io_cache_fill(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len);
+static int64_t io_cache_pread(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len);
+static void io_cache_drop(struct io_cache *cache, int64_t offset, int64_t len);
+static void io_pread_runs(struct io_ctx *ctx, struct io_req *reqs, uint32_t num);
+static struct io_ctx* io_open_image(const char *fs_name);
+static struct io_ctx* io_open_spec(struct io_ctx *parent, const char *spec);
 
 /*
  * Function Definition
  */
+/*
+ * Get monotonic time in ns, 0 if not supported
+ */
+static uint64_t io_time_ns(void)
+{
+#ifdef CMAKE_COMPILER_IS_GNUCC
+  struct timespec ts;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0;
+  }
+
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+  return 0;
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+}
+
+/*
+ * Account reads of IO started at start, with one sample of latency,
+ * called with lock held
+ */
+static void io_stat_read(struct io_ctx *ctx, uint64_t start, uint64_t reads, int64_t bytes)
+{
+  uint64_t us = (io_time_ns() - start) / 1000;
+  uint32_t i;
+
+  ctx->stat.reads += reads;
+  ctx->stat.bytes += bytes > 0 ? (uint64_t)bytes : 0;
+
+  for (i = 0; i < IO_STAT_LAT_NUM - 1 && us >= ((uint64_t)1 << i); ++i);
+  ctx->stat.lat[i] += 1;
+}
+
+/*
+ * Track reads, grow window of readahead on sequential read,
+ * and shrink it on random read, called with lock held
+ *
+ * Reads of threads interleaved look random, and so shrink window,
+ * which is as good as advice of one thread would be
+ */
+static void io_readahead(struct io_ctx *ctx, int64_t offset, int64_t len)
+{
+  int64_t start, end;
+
+  if (!ctx->ops->advise) {
+    return;
+  }
+
+  if (offset == ctx->ra_next) {
+    ctx->ra_win = ctx->ra_win ? ctx->ra_win << 1 : IO_RA_WIN_MIN;
+    ctx->ra_win = ctx->ra_win > IO_RA_WIN_MAX ? IO_RA_WIN_MAX : ctx->ra_win;
+  } else {
+    ctx->ra_win >>= 1;
+    ctx->ra_win = ctx->ra_win < IO_RA_WIN_MIN ? 0 : ctx->ra_win;
+    ctx->ra_end = 0;
+  }
+
+  ctx->ra_next = offset + len;
+
+  if (ctx->ra_win == 0) {
+    return;
+  }
+
+  /*
+   * Advise again only if less than half of window is left ahead,
+   * so that sequential reads of small size cost no extra syscall
+   */
+  if (ctx->ra_end - ctx->ra_next >= ctx->ra_win / 2) {
+    return;
+  }
+
+  start = ctx->ra_end > ctx->ra_next ? ctx->ra_end : ctx->ra_next;
+  end = ctx->ra_next + ctx->ra_win > ctx->size ? ctx->size : ctx->ra_next + ctx->ra_win;
+
+  if (start < end) {
+    ctx->ops->advise(ctx->priv, start, end - start);
+    ctx->ra_end = end;
+  }
+}
+
+/*
+ * Account read of backend done, and advise readahead after it
+ */
+static void io_read_done(struct io_ctx *ctx, uint64_t start, int64_t offset, int64_t ret)
+{
+  mutex_lock(&ctx->lock);
+
+  io_stat_read(ctx, start, 1, ret);
+
+  if (ret > 0) {
+    io_readahead(ctx, offset, ret);
+  }
+
+  mutex_unlock(&ctx->lock);
+}
+
+/*
+ * Read IO of backend at offset, bypassing cache
+ */
+static int64_t io_pread_raw(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len)
+{
+  uint64_t start;
+  int64_t ret;
+
+  if (offset >= ctx->size) {
+    return 0;
+  }
+
+  len = len > ctx->size - offset ? ctx->size - offset : len;
+
+  start = io_time_ns();
+  ret = ctx->ops->pread(ctx->priv, offset, data, len);
+  io_read_done(ctx, start, offset, ret);
+
+  return ret;
+}
+
+/*
+ * Find block in cache
+ */
+static struct io_cache_blk* io_cache_find(struct io_cache *cache, int64_t blk)
+{
+  struct io_cache_blk *cb = NULL;
+
+  for (cb = cache->hash[(uint64_t)blk & cache->hash_mask]; cb; cb = cb->hash_next) {
+    if (cb->blk == blk) {
+      break;
+    }
+  }
+
+  return cb;
+}
+
+/*
+ * Remove block from hash chain of cache
+ */
+static void io_cache_unhash(struct io_cache *cache, struct io_cache_blk *cb)
+{
+  struct io_cache_blk **pp = NULL;
+
+  for (pp = &cache->hash[(uint64_t)cb->blk & cache->hash_mask]; *pp; pp = &(*pp)->hash_next) {
+    if (*pp == cb) {
+      *pp = cb->hash_next;
+      break;
+    }
+  }
+
+  cb->hash_next = NULL;
+  cb->blk = -1;
+  cb->len = 0;
+}
+
+/*
+ * Copy data at offset out of block of cache
+ * return length of copy, 0 if offset is beyond block read
+ */
+static int64_t io_cache_copy(struct io_cache *cache, struct io_cache_blk *cb, int64_t offset, uint8_t *data, int64_t len)
+{
+  int64_t pos = offset % cache->blksz;
+
+  if (pos >= cb->len) {
+    return 0;
+  }
+
+  len = len > cb->len - pos ? cb->len - pos : len;
+  memcpy((void *)data, (const void *)(cb->data + pos), (uintptr_t)len);
+
+  return len;
+}
+
+/*
+ * Read block missed at offset into cache by evicting the least recently used one,
+ * and copy data out of it, called with lock held
+ *
+ * Block evicted is taken off LRU list and read with lock dropped,
+ * so that other blocks are served meanwhile, and if block is read
+ * by another thread in race, the one read here is put back as free
+ */
+static int64_t io_cache_fill(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len)
+{
+  struct io_cache *cache = ctx->cache;
+  struct io_cache_blk *cb = NULL, *cached = NULL;
+  int64_t blk = offset / cache->blksz;
+  int64_t ret;
+
+  /*
+   * Read bypassing cache if all blocks are being read by other threads
+   */
+  if (list_empty(&cache->lru)) {
+    mutex_unlock(&ctx->lock);
+    len = len > cache->blksz - offset % cache->blksz ? cache->blksz - offset % cache->blksz : len;
+    ret = io_pread_raw(ctx, offset, data, len);
+    mutex_lock(&ctx->lock);
+    return ret;
+  }
+
+  cb = list_entry(cache->lru.prev, struct io_cache_blk, lru);
+  if (cb->blk != -1) {
+    io_cache_unhash(cache, cb);
+  }
+  list_del_init(&cb->lru);
+
+  mutex_unlock(&ctx->lock);
+  ret = io_pread_raw(ctx, blk * cache->blksz, cb->data, cache->blksz);
+  mutex_lock(&ctx->lock);
+
+  cached = ret > 0 ? io_cache_find(cache, blk) : NULL;
+  if (ret <= 0 || cached) {
+    list_add_tail(&cb->lru, &cache->lru);
+    return ret <= 0 ? ret : io_cache_copy(cache, cached, offset, data, len);
+  }
+
+  cb->blk = blk;
+  cb->len = ret;
+  cb->hash_next = cache->hash[(uint64_t)blk & cache->hash_mask];
+  cache->hash[(uint64_t)blk & cache->hash_mask] = cb;
+  list_add(&cb->lru, &cache->lru);
+
+  return io_cache_copy(cache, cb, offset, data, len);
+}
+
+/*
+ * Read IO of file at offset through cache
+ */
+static int64_t io_cache_pread(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len)
+{
+  struct io_cache *cache = ctx->cache;
+  struct io_cache_blk *cb = NULL;
+  int64_t done, chunk;
+
+  mutex_lock(&ctx->lock);
+
+  for (done = 0; done < len; done += chunk) {
+    cb = io_cache_find(cache, (offset + done) / cache->blksz);
+    if (cb) {
+      cache->hits += 1;
+      __list_del_entry(&cb->lru);
+      list_add(&cb->lru, &cache->lru);
+      chunk = io_cache_copy(cache, cb, offset + done, data + done, len - done);
+    } else {
+      cache->misses += 1;
+      chunk = io_cache_fill(ctx, offset + done, data + done, len - done);
+    }
+
+    if (chunk <= 0) {
+      break;
+    }
+  }
+
+  mutex_unlock(&ctx->lock);
+
+  return done;
+}
+
+/*
+ * Drop blocks of cache overlapping range
+ */
+static void io_cache_drop(struct io_cache *cache, int64_t offset, int64_t len)
+{
+  struct io_cache_blk *cb = NULL;
+  int64_t blk;
+
+  if (len / cache->blksz >= (int64_t)cache->blks_num) {
+    for (blk = 0; blk < (int64_t)cache->blks_num; ++blk) {
+      if (cache->blks[blk].blk != -1) {
+        io_cache_unhash(cache, &cache->blks[blk]);
+      }
+    }
+    return;
+  }
+
+  for (blk = offset / cache->blksz; blk <= (offset + len - 1) / cache->blksz; ++blk) {
+    cb = io_cache_find(cache, blk);
+    if (cb) {
+      io_cache_unhash(cache, cb);
+    }
+  }
+}
+
+/*
+ * Read requests in runs adjacent on device, each run as one vectored read
+ */
+static void io_pread_runs(struct io_ctx *ctx, struct io_req *reqs, uint32_t num)
+{
+  struct io_vec vecs[IO_VEC_MAX];
+  uint32_t i, j, k;
+  int64_t ret;
+
+  for (i = 0; i < num; i = j) {
+    vecs[0].data = reqs[i].data;
+    vecs[0].len = reqs[i].len;
+
+    for (j = i + 1; j < num && j - i < IO_VEC_MAX; ++j) {
+      if (reqs[j].offset != reqs[j - 1].offset + reqs[j - 1].len) {
+        break;
+      }
+
+      vecs[j - i].data = reqs[j].data;
+      vecs[j - i].len = reqs[j].len;
+    }
+
+    if (j - i == 1) {
+      ret = io_pread(ctx, reqs[i].offset, reqs[i].data, reqs[i].len);
+    } else {
+      ret = io_preadv(ctx, reqs[i].offset, vecs, j - i);
+    }
+
+    for (k = i; k < j; ++k) {
+      if (ret < 0) {
+        reqs[k].ret = -1;
+        continue;
+      }
+
+      reqs[k].ret = ret > reqs[k].len ? reqs[k].len : ret;
+      ret -= reqs[k].ret;
+    }
+  }
+}
 
 /*
- * Open IO
+ * Open IO of file, and read it in place if it is Android sparse image
  */
-int32_t io_open(const char *fs_name)
+static struct io_ctx* io_open_image(const char *fs_name)
 {
+  struct io_ctx *ctx = NULL, *sparse = NULL;
+  uint32_t magic = 0;
+
+  ctx = io_open_file(fs_name);
+  if (!ctx) {
+    return NULL;
+  }
+
+  if (io_pread(ctx, 0, (uint8_t *)&magic, sizeof(magic)) != sizeof(magic) || magic != SPARSE_HEADER_MAGIC) {
+    return ctx;
+  }
+
+  /*
+   * Keep raw file if sparse image is malformed
+   */
+  sparse = io_open_sparse(ctx);
+
+  return sparse ? sparse : ctx;
+}
+
+/*
+ * Open IO of partition of parent by spec, i.e.,
+ * 'p' and number of partition, offset with optional ':' and length,
+ * or else name of partition in GPT
+ */
+static struct io_ctx* io_open_spec(struct io_ctx *parent, const char *spec)
+{
+  char *end = NULL;
+  unsigned long index;
+  int64_t offset, len = -1;
+
+  if (spec[0] == 'p' && isdigit((unsigned char)spec[1])) {
+    index = strtoul(spec + 1, &end, 10);
+    if (*end != '\0' || index == 0 || index > UINT32_MAX) {
+      return NULL;
+    }
+
+    return io_open_part(parent, (uint32_t)index);
+  }
+
+  if (isdigit((unsigned char)spec[0])) {
+    offset = (int64_t)strtoll(spec, &end, 0);
+    if (*end == ':') {
+      len = (int64_t)strtoll(end + 1, &end, 0);
+      if (len <= 0) {
+        return NULL;
+      }
+    }
+
+    if (*end != '\0' || offset < 0) {
+      return NULL;
+    }
+
+    return io_open_range(parent, offset, len);
+  }
+
+  return io_open_part_name(parent, spec);
+}
+
+/*
+ * Open IO of backend
+ * ops & priv are owned by IO from now on, and closed by io_close
+ */
+struct io_ctx* io_open_ops(const struct io_ops *ops, void *priv, int64_t size)
+{
+  struct io_ctx *ctx = NULL;
+
+  if (!ops || !ops->close || !ops->pread || size < 0) {
+    return NULL;
+  }
+
+  ctx = (struct io_ctx *)malloc(sizeof(struct io_ctx));
+  if (!ctx) {
+    return NULL;
+  }
+  memset((void *)ctx, 0, sizeof(struct io_ctx));
+
+  if (mutex_init(&ctx->lock) != 0) {
+    free((void *)ctx);
+    return NULL;
+  }
+
+  ctx->ops = ops;
+  ctx->priv = priv;
+  ctx->size = size;
+
+  return ctx;
+}
+
+/*
+ * Open IO of image, which may be followed by '#' and partition, e.g.,
+ * image.bin#p12 for partition 12 of GPT or MBR,
+ * image.bin#system for partition named system in GPT,
+ * image.bin#0x100000 or image.bin#0x100000:0x400000 for range at offset
+ */
+struct io_ctx* io_open(const char *fs_name)
+{
+  struct io_ctx *ctx = NULL, *part = NULL;
+  const char *sep = NULL;
+  char *name = NULL;
+
   if (fs_name == NULL) {
-    return -1;
+    return NULL;
   }
 
-  if (io_fd != -1) {
-    error("close io first.");
-    return -1;
+  /*
+   * Open name as is first, in case '#' is part of name of file
+   */
+  ctx = io_open_image(fs_name);
+  if (ctx) {
+    return ctx;
   }
 
-  io_fd = open64(fs_name, O_RDONLY);
-  if (io_fd == -1) {
-    return -1;
+  sep = strrchr(fs_name, '#');
+  if (!sep || sep == fs_name || sep[1] == '\0') {
+    return NULL;
   }
 
-  return 0;
+  name = (char *)malloc(sep - fs_name + 1);
+  if (!name) {
+    return NULL;
+  }
+  memcpy((void *)name, (const void *)fs_name, sep - fs_name);
+  name[sep - fs_name] = '\0';
+
+  ctx = io_open_image(name);
+  free((void *)name);
+  if (!ctx) {
+    return NULL;
+  }
+
+  part = io_open_spec(ctx, sep + 1);
+  if (!part) {
+    io_close(ctx);
+    return NULL;
+  }
+
+  return part;
 }
 
 /*
  * Close IO
  */
-void io_close(void)
+void io_close(struct io_ctx *ctx)
 {
-  if (io_fd == -1) {
+  if (!ctx) {
     return;
   }
 
-  (void)close(io_fd);
+  io_cache_exit(ctx);
+  ctx->ops->close(ctx->priv);
+
+  mutex_destroy(&ctx->lock);
+  free((void *)ctx);
+}
+
+/*
+ * Get size of IO
+ */
+int64_t io_size(struct io_ctx *ctx)
+{
+  if (!ctx) {
+    return -1;
+  }
 
-  io_fd = -1;
+  return ctx->size;
 }
 
 /*
- * Seek IO of file
+ * Read IO at offset
+ * return length of read, which is short only at the end of device
  */
-int32_t io_seek(int64_t offset)
+int64_t io_pread(struct io_ctx *ctx, int64_t offset, uint8_t *data, int64_t len)
 {
-  off64_t ret = -1;
+  const uint8_t *map = NULL;
 
-  if (offset < 0) {
+  if (!ctx || offset < 0 || data == NULL || len <= 0) {
     return -1;
   }
 
-  if (io_fd == -1) {
-    error("invalid args!");
+  /*
+   * Serve sub-block reads, e.g., dentry and extent node, from cache,
+   * and leave bulk reads of file data to bypass it,
+   * or copy them out of mapping of backend in place of cache,
+   * which would only keep a second copy of mapped blocks under lock
+   */
+  if (ctx->cache && len <= ctx->cache->blksz) {
+    map = io_map(ctx, offset, len);
+    if (map) {
+      memcpy((void *)data, (const void *)map, (uintptr_t)len);
+      return len;
+    }
+
+    return io_cache_pread(ctx, offset, data, len);
+  }
+
+  return io_pread_raw(ctx, offset, data, len);
+}
+
+/*
+ * Read IO at offset into vectors
+ * return length of read, which is short only at the end of device
+ */
+int64_t io_preadv(struct io_ctx *ctx, int64_t offset, const struct io_vec *vecs, uint32_t num)
+{
+  int64_t done, ret, len;
+  uint64_t start;
+  uint32_t i;
+
+  if (!ctx || offset < 0 || !vecs) {
     return -1;
   }
 
-  ret = lseek64(io_fd, offset, SEEK_SET);
-  if (ret == -1) {
+  for (i = 0, len = 0; i < num; ++i) {
+    if (vecs[i].data == NULL || vecs[i].len <= 0) {
+      return -1;
+    }
+    len += vecs[i].len;
+  }
+
+  if (ctx->ops->preadv && offset <= ctx->size - len) {
+    start = io_time_ns();
+    ret = ctx->ops->preadv(ctx->priv, offset, vecs, num);
+    io_read_done(ctx, start, offset, ret);
+
+    return ret;
+  }
+
+  /*
+   * Read vector by vector if not supported by backend, or across the end
+   */
+  for (i = 0, done = 0; i < num; ++i) {
+    ret = io_pread_raw(ctx, offset + done, vecs[i].data, vecs[i].len);
+    if (ret < 0) {
+      return -1;
+    }
+
+    done += ret;
+
+    if (ret < vecs[i].len) {
+      break;
+    }
+  }
+
+  return done;
+}
+
+/*
+ * Read IO in batch
+ * return 0 if all requests are read, with length of read in ret of each,
+ * which is short only at the end of device
+ */
+int32_t io_pread_batch(struct io_ctx *ctx, struct io_req *reqs, uint32_t num)
+{
+  uint32_t i, reads;
+  int64_t ret;
+  int64_t bytes;
+  uint64_t start;
+  int32_t err = 0;
+
+  if (!ctx || !reqs) {
     return -1;
   }
 
-  return 0;
+  for (i = 0; i < num; ++i) {
+    if (reqs[i].offset < 0 || reqs[i].data == NULL || reqs[i].len <= 0) {
+      return -1;
+    }
+    reqs[i].ret = -1;
+  }
+
+  /*
+   * Issue batch to backend, e.g., by io_uring, or else read in runs,
+   * where backend returns -1 if none is read
+   */
+  start = io_time_ns();
+
+  if (ctx->ops->pread_batch && num > 1 && ctx->ops->pread_batch(ctx->priv, reqs, num) == 0) {
+    for (i = 0, reads = 0, bytes = 0; i < num; ++i) {
+      reads += reqs[i].ret >= 0 ? 1 : 0;
+      bytes += reqs[i].ret > 0 ? reqs[i].ret : 0;
+    }
+
+    if (reads > 0) {
+      mutex_lock(&ctx->lock);
+      io_stat_read(ctx, start, reads, bytes);
+      mutex_unlock(&ctx->lock);
+    }
+  } else {
+    io_pread_runs(ctx, reqs, num);
+  }
+
+  /*
+   * Fall back to synchronous read for requests not done or short
+   */
+  for (i = 0; i < num; ++i) {
+    if (reqs[i].ret == reqs[i].len) {
+      continue;
+    }
+
+    if (reqs[i].ret < 0) {
+      reqs[i].ret = 0;
+    }
+
+    if (reqs[i].offset + reqs[i].ret >= ctx->size) {
+      continue;
+    }
+
+    ret = io_pread(ctx, reqs[i].offset + reqs[i].ret, reqs[i].data + reqs[i].ret, reqs[i].len - reqs[i].ret);
+    if (ret < 0) {
+      reqs[i].ret = -1;
+      err = -1;
+      continue;
+    }
+
+    reqs[i].ret += ret;
+  }
+
+  return err;
 }
 
 /*
- * Read IO of file
+ * Map IO at offset
+ * return pointer into mapping, or NULL if not mapped, then use io_pread instead
  */
-int32_t io_read(uint8_t *data, int64_t len)
+const uint8_t* io_map(struct io_ctx *ctx, int64_t offset, int64_t len)
 {
-  ssize_t ret = -1;
+  if (!ctx || !ctx->ops->map || offset < 0 || len <= 0) {
+    return NULL;
+  }
+
+  if (offset > ctx->size - len) {
+    return NULL;
+  }
 
-  if (data == NULL || len <= 0) {
+  return ctx->ops->map(ctx->priv, offset, len);
+}
+
+/*
+ * Write IO at offset
+ */
+int64_t io_pwrite(struct io_ctx *ctx, int64_t offset, const uint8_t *data, int64_t len)
+{
+  if (!ctx || !ctx->ops->pwrite || offset < 0 || data == NULL || len <= 0) {
     return -1;
   }
 
-  if (io_fd == -1) {
-    error("invalid args!");
+  if (ctx->cache) {
+    mutex_lock(&ctx->lock);
+    io_cache_drop(ctx->cache, offset, len);
+    mutex_unlock(&ctx->lock);
+  }
+
+  return ctx->ops->pwrite(ctx->priv, offset, data, len);
+}
+
+/*
+ * Init cache of IO, before IO is read by threads
+ * blksz must be power of 2, blks_num of 0 for IO_CACHE_BLKS_DEF
+ */
+int32_t io_cache_init(struct io_ctx *ctx, int64_t blksz, uint32_t blks_num)
+{
+  struct io_cache *cache = NULL;
+  uint32_t hash_num, i;
+
+  if (!ctx || blksz <= 0 || (blksz & (blksz - 1)) != 0 || blksz > IO_CACHE_BLKSZ_MAX) {
     return -1;
   }
 
-  ret = read(io_fd, (void *)data, (size_t)len);
-  if (ret == -1) {
+  io_cache_exit(ctx);
+
+  if (blks_num == 0) {
+    blks_num = IO_CACHE_BLKS_DEF;
+  }
+
+  for (hash_num = 1; hash_num < blks_num * IO_CACHE_HASH_RATIO && hash_num < 0x80000000; hash_num <<= 1);
+
+  cache = (struct io_cache *)malloc(sizeof(struct io_cache));
+  if (!cache) {
     return -1;
   }
+  memset((void *)cache, 0, sizeof(struct io_cache));
+
+  cache->blksz = blksz;
+  cache->blks_num = blks_num;
+  cache->hash_mask = hash_num - 1;
+  list_init(&cache->lru);
+
+  cache->blks = (struct io_cache_blk *)calloc(blks_num, sizeof(struct io_cache_blk));
+  cache->hash = (struct io_cache_blk **)calloc(hash_num, sizeof(struct io_cache_blk *));
+  cache->buf = (uint8_t *)malloc((uintptr_t)((uint64_t)blks_num * (uint64_t)blksz));
+  if (!cache->blks || !cache->hash || !cache->buf) {
+    goto io_cache_init_fail;
+  }
+
+  for (i = 0; i < blks_num; ++i) {
+    cache->blks[i].blk = -1;
+    cache->blks[i].data = cache->buf + (uint64_t)i * (uint64_t)blksz;
+    list_add(&cache->blks[i].lru, &cache->lru);
+  }
+
+  ctx->cache = cache;
 
   return 0;
+
+ io_cache_init_fail:
+
+  if (cache->buf) {
+    free((void *)cache->buf);
+  }
+
+  if (cache->hash) {
+    free((void *)cache->hash);
+  }
+
+  if (cache->blks) {
+    free((void *)cache->blks);
+  }
+
+  free((void *)cache);
+
+  return -1;
 }
 
 /*
- * Write IO of file
+ * Exit cache of IO
  */
-int32_t io_write(uint8_t *data, int64_t len)
+void io_cache_exit(struct io_ctx *ctx)
 {
-  ssize_t ret = -1;
+  struct io_cache *cache = NULL;
+
+  if (!ctx || !ctx->cache) {
+    return;
+  }
 
-  if (data == NULL || len <= 0) {
+  cache = ctx->cache;
+
+  free((void *)cache->buf);
+  free((void *)cache->hash);
+  free((void *)cache->blks);
+  free((void *)cache);
+
+  ctx->cache = NULL;
+}
+
+/*
+ * Get hit & miss counters of cache
+ */
+int32_t io_cache_stat(struct io_ctx *ctx, uint64_t *hits, uint64_t *misses)
+{
+  if (!ctx || !ctx->cache || !hits || !misses) {
     return -1;
   }
 
-  if (io_fd == -1) {
-    error("invalid args!");
+  mutex_lock(&ctx->lock);
+  *hits = ctx->cache->hits;
+  *misses = ctx->cache->misses;
+  mutex_unlock(&ctx->lock);
+
+  return 0;
+}
+
+/*
+ * Init direct IO, before IO is read by threads
+ * return -1 if not supported by backend, e.g., no O_DIRECT on platform
+ * or filesystem of file, then read by buffered IO instead
+ */
+int32_t io_direct_init(struct io_ctx *ctx)
+{
+  if (!ctx || !ctx->ops->direct) {
     return -1;
   }
 
-  ret = write(io_fd, (const void *)data, (size_t)len);
-  if (ret == -1) {
+  return ctx->ops->direct(ctx->priv, 1);
+}
+
+/*
+ * Exit direct IO
+ */
+void io_direct_exit(struct io_ctx *ctx)
+{
+  if (!ctx || !ctx->ops->direct) {
+    return;
+  }
+
+  (void)ctx->ops->direct(ctx->priv, 0);
+}
+
+/*
+ * Get counters of IO
+ */
+int32_t io_stat(struct io_ctx *ctx, struct io_stat *stat)
+{
+  if (!ctx || !stat) {
     return -1;
   }
 
+  mutex_lock(&ctx->lock);
+
+  memcpy((void *)stat, (const void *)&ctx->stat, sizeof(struct io_stat));
+
+  if (ctx->cache) {
+    stat->hits = ctx->cache->hits;
+    stat->misses = ctx->cache->misses;
+  }
+
+  mutex_unlock(&ctx->lock);
+
+  if (ctx->ops->stat) {
+    ctx->ops->stat(ctx->priv, stat);
+  }
+
   return 0;
 }
@@ -0,0 +1,145 @@
+/**
+ * mem.c - Memory buffer backend of IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_LIBIO_MEM
+#endif
+
+#include "include/base/debug.h"
+#include "include/libio/io.h"
+
+/*
+ * Macro Definition
+ */
+
+/*
+ * Type Definition
+ */
+struct io_mem {
+  const uint8_t *buf;
+  int64_t len;
+};
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static void io_mem_close(void *priv);
+static int64_t io_mem_pread(void *priv, int64_t offset, uint8_t *data, int64_t len);
+static const uint8_t* io_mem_map(void *priv, int64_t offset, int64_t len);
+
+static struct io_ops io_mem_ops = {
+  //.name =
+  "mem",
+
+  //.close =
+  io_mem_close,
+
+  //.pread =
+  io_mem_pread,
+
+  //.pwrite =
+  NULL,
+
+  //.preadv =
+  NULL,
+
+  //.pread_batch =
+  NULL,
+
+  //.map =
+  io_mem_map,
+
+  //.advise =
+  NULL,
+
+  //.direct =
+  NULL,
+
+  //.stat =
+  NULL,
+};
+
+/*
+ * Function Definition
+ */
+static void io_mem_close(void *priv)
+{
+  free(priv);
+}
+
+static int64_t io_mem_pread(void *priv, int64_t offset, uint8_t *data, int64_t len)
+{
+  struct io_mem *mem = (struct io_mem *)priv;
+
+  memcpy((void *)data, (const void *)(mem->buf + offset), (uintptr_t)len);
+
+  return len;
+}
+
+static const uint8_t* io_mem_map(void *priv, int64_t offset, int64_t len)
+{
+  struct io_mem *mem = (struct io_mem *)priv;
+
+  len = len;
+
+  return mem->buf + offset;
+}
+
+/*
+ * Open IO of memory buffer, e.g., image loaded or decompressed by caller
+ * buf is borrowed, and must outlive IO
+ */
+struct io_ctx* io_open_mem(const uint8_t *buf, int64_t len)
+{
+  struct io_mem *mem = NULL;
+  struct io_ctx *ctx = NULL;
+
+  if (!buf || len < 0) {
+    return NULL;
+  }
+
+  mem = (struct io_mem *)malloc(sizeof(struct io_mem));
+  if (!mem) {
+    return NULL;
+  }
+
+  mem->buf = buf;
+  mem->len = len;
+
+  ctx = io_open_ops(&io_mem_ops, (void *)mem, len);
+  if (!ctx) {
+    free((void *)mem);
+    return NULL;
+  }
+
+  return ctx;
+}
@@ -0,0 +1,294 @@
+/**
+ * part.c - Partition table of IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_LIBIO_PART
+#endif
+
+#include "include/base/debug.h"
+#include "include/libio/io.h"
+#include "include/libio/part.h"
+
+/*
+ * Macro Definition
+ */
+/*
+ * Max number of logical partitions in chain of extended partition
+ */
+#define IO_PART_LOGICAL_MAX  (128)
+
+/*
+ * Sector size of GPT on 4Kn device, e.g., UFS
+ */
+#define IO_PART_SECTOR_SZ_4K  (4096)
+
+/*
+ * Type Definition
+ */
+/*
+ * Partition found by io_part_find, matched by index if name is NULL
+ */
+struct io_part {
+  uint32_t index;
+  const char *name;
+  int64_t offset;
+  int64_t len;
+};
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static bool io_part_match_name(const struct gpt_entry *ge, const char *name);
+static int32_t io_part_find_gpt(struct io_ctx *ctx, int64_t sector, struct io_part *part);
+static int32_t io_part_find_mbr(struct io_ctx *ctx, struct io_part *part);
+static int32_t io_part_find(struct io_ctx *ctx, struct io_part *part);
+static struct io_ctx* io_part_open(struct io_ctx *parent, struct io_part *part);
+
+/*
+ * Function Definition
+ */
+/*
+ * Match name of GPT entry in UTF-16LE with name in ASCII
+ */
+static bool io_part_match_name(const struct gpt_entry *ge, const char *name)
+{
+  uint32_t i;
+
+  for (i = 0; i < GPT_ENTRY_NAME_LEN && name[i] != '\0'; ++i) {
+    if (ge->partition_name[i] != (uint16_t)(uint8_t)name[i]) {
+      return 0;
+    }
+  }
+
+  return i == GPT_ENTRY_NAME_LEN || ge->partition_name[i] == 0 ? 1 : 0;
+}
+
+/*
+ * Find partition in GPT with header at LBA 1 of sector size
+ */
+static int32_t io_part_find_gpt(struct io_ctx *ctx, int64_t sector, struct io_part *part)
+{
+  struct gpt_header gh;
+  struct gpt_entry ge;
+  int64_t offset;
+  uint32_t i;
+
+  memset((void *)&gh, 0, sizeof(struct gpt_header));
+  if (io_pread(ctx, sector, (uint8_t *)&gh, sizeof(struct gpt_header)) != sizeof(struct gpt_header)) {
+    return -1;
+  }
+
+  if (memcmp((const void *)gh.signature, (const void *)GPT_HEADER_SIGNATURE, GPT_HEADER_SIG_LEN) != 0) {
+    return -1;
+  }
+
+  if (gh.sizeof_partition_entry < GPT_ENTRY_SZ_MIN || gh.num_partition_entries > GPT_ENTRIES_MAX) {
+    return -1;
+  }
+
+  for (i = 0; i < gh.num_partition_entries; ++i) {
+    offset = (int64_t)gh.partition_entry_lba * sector + (int64_t)i * (int64_t)gh.sizeof_partition_entry;
+
+    memset((void *)&ge, 0, sizeof(struct gpt_entry));
+    if (io_pread(ctx, offset, (uint8_t *)&ge, sizeof(struct gpt_entry)) != sizeof(struct gpt_entry)) {
+      return -1;
+    }
+
+    /*
+     * Number partitions by index of entry as Linux does, counting unused ones
+     */
+    if (part->name ? !io_part_match_name(&ge, part->name) : i + 1 != part->index) {
+      continue;
+    }
+
+    if (ge.starting_lba == 0 || ge.ending_lba < ge.starting_lba) {
+      return -1;
+    }
+
+    part->offset = (int64_t)ge.starting_lba * sector;
+    part->len = (int64_t)(ge.ending_lba - ge.starting_lba + 1) * sector;
+
+    return 0;
+  }
+
+  return -1;
+}
+
+/*
+ * Find partition in MBR, with logical ones numbered from MBR_LOGICAL_MIN
+ * in chain of extended partition
+ */
+static int32_t io_part_find_mbr(struct io_ctx *ctx, struct io_part *part)
+{
+  struct mbr_partition mps[MBR_PART_NUM];
+  int64_t ext, ebr;
+  uint32_t i, index;
+  uint16_t sig;
+
+  if (part->name) {
+    return -1;
+  }
+
+  if (io_pread(ctx, MBR_SECTOR_SZ - sizeof(uint16_t), (uint8_t *)&sig, sizeof(uint16_t)) != sizeof(uint16_t)
+      || sig != MBR_SIGNATURE) {
+    return -1;
+  }
+
+  if (io_pread(ctx, MBR_PART_OFFSET, (uint8_t *)mps, sizeof(mps)) != sizeof(mps)) {
+    return -1;
+  }
+
+  for (i = 0, ext = 0; i < MBR_PART_NUM; ++i) {
+    if (mps[i].sys_ind == MBR_TYPE_EXTENDED
+        || mps[i].sys_ind == MBR_TYPE_EXTENDED_LBA
+        || mps[i].sys_ind == MBR_TYPE_EXTENDED_LNX) {
+      ext = (int64_t)mps[i].start_sect * MBR_SECTOR_SZ;
+      continue;
+    }
+
+    if (i + 1 == part->index && mps[i].sys_ind != 0 && mps[i].sys_ind != MBR_TYPE_GPT) {
+      part->offset = (int64_t)mps[i].start_sect * MBR_SECTOR_SZ;
+      part->len = (int64_t)mps[i].nr_sects * MBR_SECTOR_SZ;
+      return 0;
+    }
+  }
+
+  if (ext == 0 || part->index < MBR_LOGICAL_MIN) {
+    return -1;
+  }
+
+  /*
+   * Walk chain of EBR, each with logical partition relative to itself,
+   * and link to next EBR relative to extended partition
+   */
+  for (index = MBR_LOGICAL_MIN, ebr = ext; index < MBR_LOGICAL_MIN + IO_PART_LOGICAL_MAX; ++index) {
+    if (io_pread(ctx, ebr + MBR_SECTOR_SZ - sizeof(uint16_t), (uint8_t *)&sig, sizeof(uint16_t)) != sizeof(uint16_t)
+        || sig != MBR_SIGNATURE) {
+      return -1;
+    }
+
+    if (io_pread(ctx, ebr + MBR_PART_OFFSET, (uint8_t *)mps, 2 * sizeof(struct mbr_partition)) != 2 * sizeof(struct mbr_partition)) {
+      return -1;
+    }
+
+    if (index == part->index) {
+      if (mps[0].sys_ind == 0) {
+        return -1;
+      }
+
+      part->offset = ebr + (int64_t)mps[0].start_sect * MBR_SECTOR_SZ;
+      part->len = (int64_t)mps[0].nr_sects * MBR_SECTOR_SZ;
+      return 0;
+    }
+
+    if (mps[1].sys_ind == 0 || mps[1].start_sect == 0) {
+      break;
+    }
+
+    ebr = ext + (int64_t)mps[1].start_sect * MBR_SECTOR_SZ;
+  }
+
+  return -1;
+}
+
+/*
+ * Find partition in GPT of sector size of 512 or 4096, or else in MBR
+ */
+static int32_t io_part_find(struct io_ctx *ctx, struct io_part *part)
+{
+  if (io_part_find_gpt(ctx, MBR_SECTOR_SZ, part) == 0) {
+    return 0;
+  }
+
+  if (io_part_find_gpt(ctx, IO_PART_SECTOR_SZ_4K, part) == 0) {
+    return 0;
+  }
+
+  return io_part_find_mbr(ctx, part);
+}
+
+static struct io_ctx* io_part_open(struct io_ctx *parent, struct io_part *part)
+{
+  int64_t size;
+
+  if (!parent || io_part_find(parent, part) != 0) {
+    return NULL;
+  }
+
+  size = io_size(parent);
+  if (part->offset <= 0 || part->len <= 0 || part->offset >= size) {
+    return NULL;
+  }
+
+  /*
+   * Clip partition of truncated dump
+   */
+  part->len = part->len > size - part->offset ? size - part->offset : part->len;
+
+  return io_open_range(parent, part->offset, part->len);
+}
+
+/*
+ * Open IO of partition numbered from 1, e.g., 12 for /dev/mmcblk0p12
+ * parent is owned by IO returned, or left to caller on failure
+ */
+struct io_ctx* io_open_part(struct io_ctx *parent, uint32_t index)
+{
+  struct io_part part;
+
+  if (index == 0) {
+    return NULL;
+  }
+
+  memset((void *)&part, 0, sizeof(struct io_part));
+  part.index = index;
+
+  return io_part_open(parent, &part);
+}
+
+/*
+ * Open IO of partition by name in GPT, e.g., system
+ * parent is owned by IO returned, or left to caller on failure
+ */
+struct io_ctx* io_open_part_name(struct io_ctx *parent, const char *name)
+{
+  struct io_part part;
+
+  if (!name || name[0] == '\0') {
+    return NULL;
+  }
+
+  memset((void *)&part, 0, sizeof(struct io_part));
+  part.name = name;
+
+  return io_part_open(parent, &part);
+}
@@ -0,0 +1,235 @@
+/**
+ * range.c - Byte range backend of IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_LIBIO_RANGE
+#endif
+
+#include "include/base/debug.h"
+#include "include/libio/io.h"
+
+/*
+ * Macro Definition
+ */
+
+/*
+ * Type Definition
+ */
+struct io_range {
+  struct io_ctx *parent;
+  int64_t offset;
+  int64_t len;
+};
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static void io_range_close(void *priv);
+static int64_t io_range_pread(void *priv, int64_t offset, uint8_t *data, int64_t len);
+static int64_t io_range_preadv(void *priv, int64_t offset, const struct io_vec *vecs, uint32_t num);
+static int32_t io_range_pread_batch(void *priv, struct io_req *reqs, uint32_t num);
+static const uint8_t* io_range_map(void *priv, int64_t offset, int64_t len);
+static int32_t io_range_direct(void *priv, bool enable);
+static void io_range_stat(void *priv, struct io_stat *stat);
+
+static struct io_ops io_range_ops = {
+  //.name =
+  "range",
+
+  //.close =
+  io_range_close,
+
+  //.pread =
+  io_range_pread,
+
+  //.pwrite =
+  NULL,
+
+  //.preadv =
+  io_range_preadv,
+
+  //.pread_batch =
+  io_range_pread_batch,
+
+  //.map =
+  io_range_map,
+
+  //.advise =
+  NULL,
+
+  //.direct =
+  io_range_direct,
+
+  //.stat =
+  io_range_stat,
+};
+
+/*
+ * Function Definition
+ */
+static void io_range_close(void *priv)
+{
+  struct io_range *range = (struct io_range *)priv;
+
+  io_close(range->parent);
+  free((void *)range);
+}
+
+static int64_t io_range_pread(void *priv, int64_t offset, uint8_t *data, int64_t len)
+{
+  struct io_range *range = (struct io_range *)priv;
+
+  return io_pread(range->parent, range->offset + offset, data, len);
+}
+
+static int64_t io_range_preadv(void *priv, int64_t offset, const struct io_vec *vecs, uint32_t num)
+{
+  struct io_range *range = (struct io_range *)priv;
+
+  return io_preadv(range->parent, range->offset + offset, vecs, num);
+}
+
+/*
+ * Shift requests into parent, and clip those across the end of range
+ */
+static int32_t io_range_pread_batch(void *priv, struct io_req *reqs, uint32_t num)
+{
+  struct io_range *range = (struct io_range *)priv;
+  struct io_req *preqs = NULL;
+  int64_t size = range->len;
+  uint32_t i, cnt;
+  int32_t ret;
+
+  preqs = (struct io_req *)malloc(num * sizeof(struct io_req));
+  if (!preqs) {
+    return -1;
+  }
+
+  for (i = 0, cnt = 0; i < num; ++i) {
+    if (reqs[i].offset >= size) {
+      continue;
+    }
+
+    preqs[cnt].offset = range->offset + reqs[i].offset;
+    preqs[cnt].data = reqs[i].data;
+    preqs[cnt].len = reqs[i].len > size - reqs[i].offset ? size - reqs[i].offset : reqs[i].len;
+    preqs[cnt].ret = -1;
+    ++cnt;
+  }
+
+  ret = io_pread_batch(range->parent, preqs, cnt);
+
+  for (i = 0, cnt = 0; i < num; ++i) {
+    if (reqs[i].offset >= size) {
+      reqs[i].ret = 0;
+      continue;
+    }
+
+    reqs[i].ret = preqs[cnt].ret;
+    ++cnt;
+  }
+
+  free((void *)preqs);
+
+  return ret;
+}
+
+static const uint8_t* io_range_map(void *priv, int64_t offset, int64_t len)
+{
+  struct io_range *range = (struct io_range *)priv;
+
+  return io_map(range->parent, range->offset + offset, len);
+}
+
+static int32_t io_range_direct(void *priv, bool enable)
+{
+  struct io_range *range = (struct io_range *)priv;
+
+  if (!enable) {
+    io_direct_exit(range->parent);
+    return 0;
+  }
+
+  return io_direct_init(range->parent);
+}
+
+static void io_range_stat(void *priv, struct io_stat *stat)
+{
+  struct io_range *range = (struct io_range *)priv;
+  struct io_stat ps;
+
+  if (io_stat(range->parent, &ps) == 0) {
+    stat->seeks += ps.seeks;
+  }
+}
+
+/*
+ * Open IO of byte range of parent, e.g., partition of disk image
+ * len of -1 for the rest of parent
+ * parent is owned by IO returned, or left to caller on failure
+ */
+struct io_ctx* io_open_range(struct io_ctx *parent, int64_t offset, int64_t len)
+{
+  struct io_range *range = NULL;
+  struct io_ctx *ctx = NULL;
+  int64_t size;
+
+  size = io_size(parent);
+  if (size < 0 || offset < 0 || offset > size) {
+    return NULL;
+  }
+
+  if (len < 0) {
+    len = size - offset;
+  }
+
+  if (len > size - offset) {
+    return NULL;
+  }
+
+  range = (struct io_range *)malloc(sizeof(struct io_range));
+  if (!range) {
+    return NULL;
+  }
+
+  range->parent = parent;
+  range->offset = offset;
+  range->len = len;
+
+  ctx = io_open_ops(&io_range_ops, (void *)range, len);
+  if (!ctx) {
+    free((void *)range);
+    return NULL;
+  }
+
+  return ctx;
+}
@@ -0,0 +1,328 @@
+/**
+ * ring.c - io_uring ring for batched IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef CMAKE_COMPILER_IS_GNUCC
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif /* CMAKE_COMPILER_IS_GNUCC */
+
+#ifdef YF_IO_URING
+#include <linux/io_uring.h>
+#endif /* YF_IO_URING */
+
+#ifdef DEBUG
+#define DEBUG_LIBIO_RING
+#endif
+
+#include "include/base/debug.h"
+#include "include/libio/ring.h"
+
+/*
+ * Macro Definition
+ */
+#if defined(CMAKE_COMPILER_IS_GNUCC) && defined(YF_IO_URING) && defined(__NR_io_uring_setup)
+#define IO_RING_SUPPORTED
+#endif
+
+/*
+ * Max length of one read, for length of sqe is 32-bit
+ */
+#define IO_RING_LEN_MAX  (0x40000000)
+
+/*
+ * Type Definition
+ */
+#ifdef IO_RING_SUPPORTED
+struct io_ring {
+  int ring_fd;
+  int fd;
+
+  /*
+   * Submission queue
+   */
+  void *sq_ptr;
+  uintptr_t sq_sz;
+  uint32_t *sq_head;
+  uint32_t *sq_tail;
+  uint32_t *sq_mask;
+  uint32_t *sq_array;
+  uint32_t sq_entries;
+  struct io_uring_sqe *sqes;
+  uintptr_t sqes_sz;
+
+  /*
+   * Completion queue, sharing mapping with submission queue if single mmap
+   */
+  void *cq_ptr;
+  uintptr_t cq_sz;
+  uint32_t *cq_head;
+  uint32_t *cq_tail;
+  uint32_t *cq_mask;
+  struct io_uring_cqe *cqes;
+};
+#endif /* IO_RING_SUPPORTED */
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+#ifdef IO_RING_SUPPORTED
+static int32_t io_ring_enter(struct io_ring *ring, uint32_t to_submit, uint32_t min_complete);
+static uint32_t io_ring_reap(struct io_ring *ring, struct io_req *reqs);
+#endif /* IO_RING_SUPPORTED */
+
+/*
+ * Function Definition
+ */
+#ifdef IO_RING_SUPPORTED
+/*
+ * Submit & wait for completion
+ * return number of sqes submitted, or -1 on error
+ */
+static int32_t io_ring_enter(struct io_ring *ring, uint32_t to_submit, uint32_t min_complete)
+{
+  long ret;
+
+  do {
+    ret = syscall(__NR_io_uring_enter, ring->ring_fd, to_submit, min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+  } while (ret == -1 && errno == EINTR);
+
+  return ret < 0 ? -1 : (int32_t)ret;
+}
+
+/*
+ * Reap cqes of completion queue
+ * return number of requests completed
+ */
+static uint32_t io_ring_reap(struct io_ring *ring, struct io_req *reqs)
+{
+  struct io_uring_cqe *cqe = NULL;
+  uint32_t head, tail, num = 0;
+
+  head = *ring->cq_head;
+  tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+  for (; head != tail; ++head, ++num) {
+    cqe = &ring->cqes[head & *ring->cq_mask];
+    reqs[cqe->user_data].ret = cqe->res < 0 ? -1 : (int64_t)cqe->res;
+  }
+
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+  return num;
+}
+#endif /* IO_RING_SUPPORTED */
+
+/*
+ * Open ring of io_uring on fd
+ * return NULL if io_uring is not supported by kernel or build,
+ * then read synchronously instead
+ */
+struct io_ring* io_ring_open(int fd, uint32_t entries)
+{
+#ifdef IO_RING_SUPPORTED
+  struct io_uring_params p;
+  struct io_ring *ring = NULL;
+  void *ptr = NULL;
+
+  ring = (struct io_ring *)malloc(sizeof(struct io_ring));
+  if (!ring) {
+    return NULL;
+  }
+  memset((void *)ring, 0, sizeof(struct io_ring));
+
+  memset((void *)&p, 0, sizeof(struct io_uring_params));
+  ring->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+  if (ring->ring_fd < 0) {
+    free((void *)ring);
+    return NULL;
+  }
+
+  ring->fd = fd;
+  ring->sq_entries = p.sq_entries;
+  ring->sq_sz = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+  ring->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->sq_sz = ring->sq_sz > ring->cq_sz ? ring->sq_sz : ring->cq_sz;
+    ring->cq_sz = ring->sq_sz;
+  }
+
+  ptr = mmap(NULL, ring->sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING);
+  if (ptr == MAP_FAILED) {
+    goto io_ring_open_fail;
+  }
+  ring->sq_ptr = ptr;
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ptr = ring->sq_ptr;
+  } else {
+    ptr = mmap(NULL, ring->cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING);
+    if (ptr == MAP_FAILED) {
+      goto io_ring_open_fail;
+    }
+    ring->cq_ptr = ptr;
+  }
+
+  ptr = mmap(NULL, ring->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES);
+  if (ptr == MAP_FAILED) {
+    goto io_ring_open_fail;
+  }
+  ring->sqes = (struct io_uring_sqe *)ptr;
+
+  ring->sq_head = (uint32_t *)((uint8_t *)ring->sq_ptr + p.sq_off.head);
+  ring->sq_tail = (uint32_t *)((uint8_t *)ring->sq_ptr + p.sq_off.tail);
+  ring->sq_mask = (uint32_t *)((uint8_t *)ring->sq_ptr + p.sq_off.ring_mask);
+  ring->sq_array = (uint32_t *)((uint8_t *)ring->sq_ptr + p.sq_off.array);
+
+  ring->cq_head = (uint32_t *)((uint8_t *)ring->cq_ptr + p.cq_off.head);
+  ring->cq_tail = (uint32_t *)((uint8_t *)ring->cq_ptr + p.cq_off.tail);
+  ring->cq_mask = (uint32_t *)((uint8_t *)ring->cq_ptr + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)((uint8_t *)ring->cq_ptr + p.cq_off.cqes);
+
+  return ring;
+
+ io_ring_open_fail:
+
+  io_ring_close(ring);
+
+  return NULL;
+#else
+  fd = fd;
+  entries = entries;
+
+  return NULL;
+#endif /* IO_RING_SUPPORTED */
+}
+
+/*
+ * Close ring of io_uring
+ */
+void io_ring_close(struct io_ring *ring)
+{
+#ifdef IO_RING_SUPPORTED
+  if (!ring) {
+    return;
+  }
+
+  if (ring->sqes) {
+    (void)munmap((void *)ring->sqes, ring->sqes_sz);
+  }
+
+  if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr) {
+    (void)munmap(ring->cq_ptr, ring->cq_sz);
+  }
+
+  if (ring->sq_ptr) {
+    (void)munmap(ring->sq_ptr, ring->sq_sz);
+  }
+
+  (void)close(ring->ring_fd);
+
+  free((void *)ring);
+#else
+  ring = ring;
+#endif /* IO_RING_SUPPORTED */
+}
+
+/*
+ * Read requests in batch, queued up to depth of ring per submission
+ * return 0 if all are completed, with length of read or -1 in ret of each,
+ * or -1 if ring fails, then ring is unusable and should be closed
+ */
+int32_t io_ring_pread(struct io_ring *ring, struct io_req *reqs, uint32_t num)
+{
+#ifdef IO_RING_SUPPORTED
+  struct io_uring_sqe *sqe = NULL;
+  uint32_t next, queued, inflight, done, tail, idx;
+  int32_t ret;
+
+  if (!ring || !reqs) {
+    return -1;
+  }
+
+  for (next = 0, queued = 0, inflight = 0, done = 0; done < num;) {
+    tail = *ring->sq_tail;
+
+    for (; next < num && queued + inflight < ring->sq_entries; ++next, ++queued, ++tail) {
+      idx = tail & *ring->sq_mask;
+      sqe = &ring->sqes[idx];
+
+      memset((void *)sqe, 0, sizeof(struct io_uring_sqe));
+      sqe->opcode = IORING_OP_READ;
+      sqe->fd = ring->fd;
+      sqe->off = (uint64_t)reqs[next].offset;
+      sqe->addr = (uint64_t)(uintptr_t)reqs[next].data;
+      sqe->len = (uint32_t)(reqs[next].len > IO_RING_LEN_MAX ? IO_RING_LEN_MAX : reqs[next].len);
+      sqe->user_data = next;
+
+      ring->sq_array[idx] = idx;
+      reqs[next].ret = -1;
+    }
+
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    ret = io_ring_enter(ring, queued, 1);
+    if (ret < 0) {
+      /*
+       * Withdraw sqes not consumed yet, and wait for those in flight,
+       * so that no buffer is written after return
+       */
+      __atomic_store_n(ring->sq_tail, tail - queued, __ATOMIC_RELEASE);
+
+      while (inflight > 0) {
+        if (io_ring_enter(ring, 0, inflight) < 0) {
+          break;
+        }
+        inflight -= io_ring_reap(ring, reqs);
+      }
+
+      return -1;
+    }
+
+    queued -= (uint32_t)ret;
+    inflight += (uint32_t)ret;
+
+    ret = (int32_t)io_ring_reap(ring, reqs);
+    inflight -= (uint32_t)ret;
+    done += (uint32_t)ret;
+  }
+
+  return 0;
+#else
+  ring = ring;
+  reqs = reqs;
+  num = num;
+
+  return -1;
+#endif /* IO_RING_SUPPORTED */
+}
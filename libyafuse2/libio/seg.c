@@ -0,0 +1,262 @@
+/**
+ * seg.c - Segmented image backend of IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_LIBIO_SEG
+#endif
+
+#include "include/base/debug.h"
+#include "include/libio/io.h"
+
+/*
+ * Macro Definition
+ */
+
+/*
+ * Type Definition
+ */
+struct io_seg {
+  struct io_ctx **segs;
+  int64_t *starts;
+  uint32_t segs_num;
+};
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static uint32_t io_seg_find(struct io_seg *seg, int64_t offset);
+static void io_seg_close(void *priv);
+static int64_t io_seg_pread(void *priv, int64_t offset, uint8_t *data, int64_t len);
+static const uint8_t* io_seg_map(void *priv, int64_t offset, int64_t len);
+static int32_t io_seg_direct(void *priv, bool enable);
+static void io_seg_stat(void *priv, struct io_stat *stat);
+
+static struct io_ops io_seg_ops = {
+  //.name =
+  "seg",
+
+  //.close =
+  io_seg_close,
+
+  //.pread =
+  io_seg_pread,
+
+  //.pwrite =
+  NULL,
+
+  //.preadv =
+  NULL,
+
+  //.pread_batch =
+  NULL,
+
+  //.map =
+  io_seg_map,
+
+  //.advise =
+  NULL,
+
+  //.direct =
+  io_seg_direct,
+
+  //.stat =
+  io_seg_stat,
+};
+
+/*
+ * Function Definition
+ */
+/*
+ * Find segment covering offset by binary search
+ */
+static uint32_t io_seg_find(struct io_seg *seg, int64_t offset)
+{
+  uint32_t low = 0, high = seg->segs_num, mid;
+
+  while (high - low > 1) {
+    mid = low + (high - low) / 2;
+
+    if (seg->starts[mid] <= offset) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+static void io_seg_close(void *priv)
+{
+  struct io_seg *seg = (struct io_seg *)priv;
+  uint32_t i;
+
+  for (i = 0; i < seg->segs_num; ++i) {
+    io_close(seg->segs[i]);
+  }
+
+  if (seg->segs) {
+    free((void *)seg->segs);
+  }
+
+  if (seg->starts) {
+    free((void *)seg->starts);
+  }
+
+  free((void *)seg);
+}
+
+/*
+ * Read image at offset, splitting read across segments
+ */
+static int64_t io_seg_pread(void *priv, int64_t offset, uint8_t *data, int64_t len)
+{
+  struct io_seg *seg = (struct io_seg *)priv;
+  int64_t done, pos, chunk, ret;
+  uint32_t index;
+
+  index = io_seg_find(seg, offset);
+
+  for (done = 0; done < len && index < seg->segs_num; done += chunk, ++index) {
+    pos = offset + done - seg->starts[index];
+    chunk = io_size(seg->segs[index]) - pos;
+    chunk = len - done > chunk ? chunk : len - done;
+
+    if (chunk <= 0) {
+      continue;
+    }
+
+    ret = io_pread(seg->segs[index], pos, data + done, chunk);
+    if (ret < 0) {
+      return -1;
+    }
+
+    if (ret < chunk) {
+      return done + ret;
+    }
+  }
+
+  return done;
+}
+
+/*
+ * Map range within one segment
+ */
+static const uint8_t* io_seg_map(void *priv, int64_t offset, int64_t len)
+{
+  struct io_seg *seg = (struct io_seg *)priv;
+  uint32_t index;
+
+  index = io_seg_find(seg, offset);
+
+  return io_map(seg->segs[index], offset - seg->starts[index], len);
+}
+
+static int32_t io_seg_direct(void *priv, bool enable)
+{
+  struct io_seg *seg = (struct io_seg *)priv;
+  uint32_t i;
+
+  for (i = 0; i < seg->segs_num; ++i) {
+    if (!enable) {
+      io_direct_exit(seg->segs[i]);
+    } else if (io_direct_init(seg->segs[i]) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static void io_seg_stat(void *priv, struct io_stat *stat)
+{
+  struct io_seg *seg = (struct io_seg *)priv;
+  struct io_stat ss;
+  uint32_t i;
+
+  for (i = 0; i < seg->segs_num; ++i) {
+    if (io_stat(seg->segs[i], &ss) == 0) {
+      stat->seeks += ss.seeks;
+    }
+  }
+}
+
+/*
+ * Open IO of image split into files of segments, concatenated in order
+ */
+struct io_ctx* io_open_segs(const char * const *names, uint32_t num)
+{
+  struct io_seg *seg = NULL;
+  struct io_ctx *ctx = NULL;
+  int64_t size;
+  uint32_t i;
+
+  if (!names || num == 0) {
+    return NULL;
+  }
+
+  seg = (struct io_seg *)malloc(sizeof(struct io_seg));
+  if (!seg) {
+    return NULL;
+  }
+  memset((void *)seg, 0, sizeof(struct io_seg));
+
+  seg->segs = (struct io_ctx **)calloc(num, sizeof(struct io_ctx *));
+  seg->starts = (int64_t *)calloc(num, sizeof(int64_t));
+  if (!seg->segs || !seg->starts) {
+    goto io_open_segs_fail;
+  }
+
+  for (i = 0, size = 0; i < num; ++i) {
+    seg->segs[i] = io_open_file(names[i]);
+    if (!seg->segs[i]) {
+      goto io_open_segs_fail;
+    }
+
+    seg->segs_num += 1;
+    seg->starts[i] = size;
+    size += io_size(seg->segs[i]);
+  }
+
+  ctx = io_open_ops(&io_seg_ops, (void *)seg, size);
+  if (!ctx) {
+    goto io_open_segs_fail;
+  }
+
+  return ctx;
+
+ io_open_segs_fail:
+
+  io_seg_close((void *)seg);
+
+  return NULL;
+}
@@ -0,0 +1,363 @@
+/**
+ * sparse.c - Android sparse image backend of IO.
+ *
+ * Copyright (c) 2013-2014 angersax@gmail.com
+ *
+ * This file is part of libyafuse2.
+ *
+ * libyafuse2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libyafuse2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libyafuse2.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_LIBIO_SPARSE
+#endif
+
+#include "include/base/debug.h"
+#include "include/libio/io.h"
+#include "include/libio/sparse.h"
+
+/*
+ * Macro Definition
+ */
+
+/*
+ * Type Definition
+ */
+/*
+ * Chunk of output image, with offset of its data in sparse image
+ * for raw chunk, or value for fill chunk
+ */
+struct io_sparse_chunk {
+  int64_t start;
+  int64_t len;
+  uint16_t type;
+  uint32_t fill;
+  int64_t data;
+};
+
+struct io_sparse {
+  struct io_ctx *parent;
+  struct io_sparse_chunk *chunks;
+  uint32_t chunks_num;
+};
+
+/*
+ * Global Variable Definition
+ */
+
+/*
+ * Function Declaration
+ */
+static int32_t io_sparse_parse(struct io_sparse *sparse, const struct sparse_header *sh);
+static uint32_t io_sparse_find(struct io_sparse *sparse, int64_t offset);
+static void io_sparse_close(void *priv);
+static int64_t io_sparse_pread(void *priv, int64_t offset, uint8_t *data, int64_t len);
+static const uint8_t* io_sparse_map(void *priv, int64_t offset, int64_t len);
+static int32_t io_sparse_direct(void *priv, bool enable);
+static void io_sparse_stat(void *priv, struct io_stat *stat);
+
+static struct io_ops io_sparse_ops = {
+  //.name =
+  "sparse",
+
+  //.close =
+  io_sparse_close,
+
+  //.pread =
+  io_sparse_pread,
+
+  //.pwrite =
+  NULL,
+
+  //.preadv =
+  NULL,
+
+  //.pread_batch =
+  NULL,
+
+  //.map =
+  io_sparse_map,
+
+  //.advise =
+  NULL,
+
+  //.direct =
+  io_sparse_direct,
+
+  //.stat =
+  io_sparse_stat,
+};
+
+/*
+ * Function Definition
+ */
+/*
+ * Parse table of chunks, skipping CRC32 chunk without output
+ */
+static int32_t io_sparse_parse(struct io_sparse *sparse, const struct sparse_header *sh)
+{
+  struct chunk_header ch;
+  struct io_sparse_chunk *sc = NULL;
+  int64_t offset, start, len;
+  uint32_t i, blks;
+
+  sparse->chunks = (struct io_sparse_chunk *)calloc(sh->total_chunks ? sh->total_chunks : 1, sizeof(struct io_sparse_chunk));
+  if (!sparse->chunks) {
+    return -1;
+  }
+
+  offset = (int64_t)sh->file_hdr_sz;
+  start = 0;
+  blks = 0;
+
+  for (i = 0; i < sh->total_chunks; ++i) {
+    memset((void *)&ch, 0, sizeof(struct chunk_header));
+    if (io_pread(sparse->parent, offset, (uint8_t *)&ch, sizeof(struct chunk_header)) != sizeof(struct chunk_header)) {
+      return -1;
+    }
+
+    if (ch.total_sz < sh->chunk_hdr_sz) {
+      return -1;
+    }
+
+    len = (int64_t)ch.chunk_sz * (int64_t)sh->blk_sz;
+    sc = &sparse->chunks[sparse->chunks_num];
+
+    switch (ch.chunk_type) {
+    case CHUNK_TYPE_RAW:
+      if ((int64_t)ch.total_sz != (int64_t)sh->chunk_hdr_sz + len) {
+        return -1;
+      }
+      sc->data = offset + sh->chunk_hdr_sz;
+      break;
+    case CHUNK_TYPE_FILL:
+      if (ch.total_sz != sh->chunk_hdr_sz + sizeof(uint32_t)) {
+        return -1;
+      }
+      if (io_pread(sparse->parent, offset + sh->chunk_hdr_sz, (uint8_t *)&sc->fill, sizeof(uint32_t)) != sizeof(uint32_t)) {
+        return -1;
+      }
+      break;
+    case CHUNK_TYPE_DONT_CARE:
+      break;
+    case CHUNK_TYPE_CRC32:
+      offset += ch.total_sz;
+      continue;
+    default:
+      return -1;
+    }
+
+    sc->start = start;
+    sc->len = len;
+    sc->type = ch.chunk_type;
+
+    start += len;
+    blks += ch.chunk_sz;
+    offset += ch.total_sz;
+
+    if (len > 0) {
+      sparse->chunks_num += 1;
+    }
+  }
+
+  if (blks != sh->total_blks) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Find chunk covering offset by binary search
+ */
+static uint32_t io_sparse_find(struct io_sparse *sparse, int64_t offset)
+{
+  uint32_t low = 0, high = sparse->chunks_num, mid;
+
+  while (high - low > 1) {
+    mid = low + (high - low) / 2;
+
+    if (sparse->chunks[mid].start <= offset) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+static void io_sparse_close(void *priv)
+{
+  struct io_sparse *sparse = (struct io_sparse *)priv;
+
+  io_close(sparse->parent);
+
+  if (sparse->chunks) {
+    free((void *)sparse->chunks);
+  }
+
+  free((void *)sparse);
+}
+
+/*
+ * Read output image at offset, chunk by chunk
+ */
+static int64_t io_sparse_pread(void *priv, int64_t offset, uint8_t *data, int64_t len)
+{
+  struct io_sparse *sparse = (struct io_sparse *)priv;
+  struct io_sparse_chunk *sc = NULL;
+  int64_t done, pos, chunk, ret, i;
+  uint32_t index;
+
+  index = io_sparse_find(sparse, offset);
+
+  for (done = 0; done < len && index < sparse->chunks_num; done += chunk, ++index) {
+    sc = &sparse->chunks[index];
+    pos = offset + done - sc->start;
+    chunk = len - done > sc->len - pos ? sc->len - pos : len - done;
+
+    switch (sc->type) {
+    case CHUNK_TYPE_RAW:
+      ret = io_pread(sparse->parent, sc->data + pos, data + done, chunk);
+      if (ret < 0) {
+        return -1;
+      }
+
+      if (ret < chunk) {
+        return done + ret;
+      }
+      break;
+    case CHUNK_TYPE_FILL:
+      /*
+       * Pattern of fill repeats every 4 bytes from start of chunk
+       */
+      for (i = 0; i < chunk; ++i) {
+        data[done + i] = ((const uint8_t *)&sc->fill)[(pos + i) % sizeof(uint32_t)];
+      }
+      break;
+    default:
+      memset((void *)(data + done), 0, (uintptr_t)chunk);
+      break;
+    }
+  }
+
+  return done;
+}
+
+/*
+ * Map range within one raw chunk
+ */
+static const uint8_t* io_sparse_map(void *priv, int64_t offset, int64_t len)
+{
+  struct io_sparse *sparse = (struct io_sparse *)priv;
+  struct io_sparse_chunk *sc = NULL;
+
+  if (sparse->chunks_num == 0) {
+    return NULL;
+  }
+
+  sc = &sparse->chunks[io_sparse_find(sparse, offset)];
+  if (sc->type != CHUNK_TYPE_RAW || offset + len > sc->start + sc->len) {
+    return NULL;
+  }
+
+  return io_map(sparse->parent, sc->data + offset - sc->start, len);
+}
+
+static int32_t io_sparse_direct(void *priv, bool enable)
+{
+  struct io_sparse *sparse = (struct io_sparse *)priv;
+
+  if (!enable) {
+    io_direct_exit(sparse->parent);
+    return 0;
+  }
+
+  return io_direct_init(sparse->parent);
+}
+
+static void io_sparse_stat(void *priv, struct io_stat *stat)
+{
+  struct io_sparse *sparse = (struct io_sparse *)priv;
+  struct io_stat ps;
+
+  if (io_stat(sparse->parent, &ps) == 0) {
+    stat->seeks += ps.seeks;
+  }
+}
+
+/*
+ * Open IO of Android sparse image, to read output image in place
+ * parent is owned by IO returned, or left to caller on failure
+ */
+struct io_ctx* io_open_sparse(struct io_ctx *parent)
+{
+  struct sparse_header sh;
+  struct io_sparse *sparse = NULL;
+  struct io_ctx *ctx = NULL;
+
+  if (!parent) {
+    return NULL;
+  }
+
+  memset((void *)&sh, 0, sizeof(struct sparse_header));
+  if (io_pread(parent, 0, (uint8_t *)&sh, sizeof(struct sparse_header)) != sizeof(struct sparse_header)) {
+    return NULL;
+  }
+
+  if (sh.magic != SPARSE_HEADER_MAGIC
+      || sh.major_version != SPARSE_MAJOR_VERSION
+      || sh.file_hdr_sz < SPARSE_FILE_HDR_SZ
+      || sh.chunk_hdr_sz < SPARSE_CHUNK_HDR_SZ
+      || sh.blk_sz == 0
+      || sh.blk_sz % sizeof(uint32_t) != 0) {
+    return NULL;
+  }
+
+  sparse = (struct io_sparse *)malloc(sizeof(struct io_sparse));
+  if (!sparse) {
+    return NULL;
+  }
+  memset((void *)sparse, 0, sizeof(struct io_sparse));
+  sparse->parent = parent;
+
+  if (io_sparse_parse(sparse, &sh) != 0) {
+    goto io_open_sparse_fail;
+  }
+
+  ctx = io_open_ops(&io_sparse_ops, (void *)sparse, (int64_t)sh.total_blks * (int64_t)sh.blk_sz);
+  if (!ctx) {
+    goto io_open_sparse_fail;
+  }
+
+  return ctx;
+
+ io_open_sparse_fail:
+
+  if (sparse->chunks) {
+    free((void *)sparse->chunks);
+  }
+
+  free((void *)sparse);
+
+  return NULL;
+}